@@ -0,0 +1,713 @@
+/*
+ * Benchmarks for the agenda's data structures and commands
+ *
+ * Usage: bench [--json] [path of a.out]
+ * Every result is one line: readable by default, or a JSON object per line with --json for tracking
+ * results across commits. The commands are only timed end to end when the path of a.out is given.
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../appointment.h"
+#include "../agenda_index.h"
+#include "../agenda_log.h"
+#include "../agenda_tombstones.h"
+#include "../agenda_dedupe.h"
+#include "../agenda_arena.h"
+#include "../interval_tree.h"
+#include "../schedule.h"
+#include "../trigram_index.h"
+using namespace std;
+
+const unsigned SEED = 2400;
+
+static size_t allocations = 0;  // calls to operator new so far
+static bool jsonOutput = false;  // whether results are printed as JSON lines
+volatile size_t sink = 0;        // results of timed work, kept so the optimizer can't drop the work
+
+void *operator new(size_t size) {
+    allocations++;
+    void *block = malloc(size == 0 ? 1 : size);
+    if (block == NULL) {
+        throw bad_alloc();
+    }
+    return block;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *block) noexcept {
+    free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    free(block);
+}
+
+// memory resources allocate through the aligned forms, titles of appointments included
+void *operator new(size_t size, align_val_t alignment) {
+    allocations++;
+    void *block = NULL;
+    if (posix_memalign(&block, max(static_cast<size_t>(alignment), sizeof(void *)), size == 0 ? 1 : size) != 0) {
+        throw bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void *block, align_val_t) noexcept {
+    free(block);
+}
+
+void operator delete(void *block, size_t, align_val_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void *block) noexcept {
+    free(block);
+}
+
+/**
+ * Function: elapsedNs
+ * @brief Gets the nanoseconds since a starting point.
+ */
+static double elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Function: report
+ * @brief Prints one result.
+ *
+ * @param name what was timed
+ * @param n size of the agenda or data set
+ * @param ops number of operations timed
+ * @param ns total nanoseconds
+ * @param allocated number of allocations made, or -1 if they couldn't be counted
+ */
+static void report(const string &name, size_t n, size_t ops, double ns, long long allocated) {
+    double nsPerOp = ns / ops;
+    if (jsonOutput) {
+        cout << fixed << setprecision(1) << "{\"name\":\"" << name << "\",\"n\":" << n << ",\"ops\":" << ops
+             << ",\"ns_per_op\":" << nsPerOp << ",\"ops_per_sec\":" << 1e9 / nsPerOp;
+        if (allocated >= 0) {
+            cout << setprecision(2) << ",\"allocs_per_op\":" << static_cast<double>(allocated) / ops;
+        }
+        cout << "}" << endl;
+    }
+    else {
+        cout << fixed << setprecision(1) << left << setw(20) << name << right << " n=" << setw(8) << n << " ops=" << setw(8) << ops
+             << setw(14) << nsPerOp << " ns/op" << setprecision(0) << setw(14) << 1e9 / nsPerOp << " ops/s";
+        if (allocated >= 0) {
+            cout << setprecision(2) << setw(10) << static_cast<double>(allocated) / ops << " allocs/op";
+        }
+        cout << endl;
+    }
+}
+
+/**
+ * Function: measure
+ * @brief Times a piece of work and reports it, with the allocations it made.
+ *
+ * @param name what is timed
+ * @param n size of the agenda or data set
+ * @param ops number of operations the work does
+ * @param work the work
+ */
+template <class Work>
+static void measure(const string &name, size_t n, size_t ops, Work work) {
+    size_t allocatedBefore = allocations;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    work();
+    double ns = elapsedNs(start);
+    report(name, n, ops, ns, allocations - allocatedBefore);
+}
+
+/**
+ * Function: makeAgenda
+ * @brief Makes the lines of a synthetic agenda, with a thousand titles repeated over two years.
+ *
+ * @param count number of appointments
+ * @return one appointment string per appointment
+ */
+static vector<string> makeAgenda(size_t count) {
+    mt19937 random(SEED);
+    uniform_int_distribution<int> titleDist(0, 999);
+    uniform_int_distribution<int> yearDist(2020, 2021);
+    uniform_int_distribution<int> monthDist(1, 12);
+    uniform_int_distribution<int> dayDist(1, 28);
+    uniform_int_distribution<int> hourDist(1, 12);
+    uniform_int_distribution<int> quarterDist(0, 3);
+    uniform_int_distribution<int> durationDist(1, 120);
+
+    vector<string> lines(count);
+    for (size_t i = 0; i < count; i++) {
+        ostringstream line;
+        line << "Meeting " << titleDist(random) << "|" << yearDist(random) << "|" << monthDist(random) << "|" << dayDist(random) << "|"
+             << hourDist(random) << ":" << setw(2) << setfill('0') << quarterDist(random) * 15 << (i % 2 == 0 ? " AM" : " PM") << "|" << durationDist(random);
+        lines[i] = line.str();
+    }
+
+    return lines;
+}
+
+/**
+ * Function: benchAppointments
+ * @brief Times parsing and formatting appointments and converting their times.
+ *
+ * @param count number of appointments
+ */
+static void benchAppointments(size_t count) {
+    vector<string> lines = makeAgenda(count);
+    vector<Appointment> appointments;
+    appointments.reserve(count);
+    measure("parse", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            appointments.push_back(Appointment(lines[i]));
+        }
+    });
+
+    size_t length = 0;
+    measure("format", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            length += appointments[i].getAppointmentString().length();
+        }
+    });
+
+    string line;  // one buffer for every line, like printPage and writeAppointments use
+    measure("format.append", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            line.clear();
+            appointments[i].appendAppointmentString(line);
+            length += line.length();
+        }
+    });
+
+    // what a delete by title does to every record it reads back
+    size_t matches = 0;
+    measure("title.compare", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            matches += appointments[i].getTitle() == "Meeting 500";
+        }
+    });
+
+    // a delete in any case, by uppercasing both titles for every comparison and by the precomputed keys
+    string query = "MEETING 500";
+    measure("title.upper", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            matches += appointments[i].stringToUpper(appointments[i].getTitle()) == appointments[i].stringToUpper(query);
+        }
+    });
+    measure("title.key", count, count, [&]() {
+        uint32_t key = Appointment::foldedHash(query);
+        for (size_t i = 0; i < count; i++) {
+            matches += appointments[i].matchesTitle(query, key);
+        }
+    });
+
+    vector<string> standardTimes(count);
+    measure("militaryToStandard", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            standardTimes[i] = appointments[i].militaryToStandard(appointments[i].getTime());
+        }
+    });
+
+    int timeSum = 0;
+    measure("standardToMilitary", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            timeSum += appointments[i].standardToMilitary(standardTimes[i]);
+        }
+    });
+    sink = sink + length + timeSum + matches;
+}
+
+/**
+ * Function: benchArena
+ * @brief Times loading appointments whose titles are too long for the short string buffer, and freeing them,
+ * with titles from the default allocator and from an arena.
+ *
+ * @param count number of appointments
+ */
+static void benchArena(size_t count) {
+    vector<string> lines = makeAgenda(count);
+    for (size_t i = 0; i < count; i++) {
+        lines[i] = "Quarterly planning with " + lines[i];
+    }
+
+    vector<Appointment> appointments;
+    appointments.reserve(count);
+    measure("load.default", count, count, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            appointments.emplace_back(lines[i]);
+        }
+    });
+    measure("free.default", count, count, [&]() {
+        appointments.clear();
+    });
+
+    // one part sized like the lines, as loadAppointments gives each of its threads
+    AgendaArena *arena = new AgendaArena();
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes += lines[i].length() + 1;
+    }
+    measure("load.arena", count, count, [&]() {
+        pmr::memory_resource *titles = arena->addPart(bytes);
+        for (size_t i = 0; i < count; i++) {
+            appointments.emplace_back(lines[i], titles);
+        }
+    });
+    measure("free.arena", count, count, [&]() {
+        appointments.clear();
+        delete arena;
+    });
+}
+
+/**
+ * Function: benchQueries
+ * @brief Times the -ps ordering, -p lookups and both delete paths on an agenda file in the working directory.
+ *
+ * @param count number of appointments
+ * @param queries number of lookups and deletes
+ */
+static void benchQueries(size_t count, size_t queries) {
+    const string path = "queries-agenda.txt";
+    vector<string> lines = makeAgenda(count);
+    vector<Appointment> appointments;
+    AgendaIndex index;
+    ofstream agendaFile(path, ios::binary);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        appointments.push_back(Appointment(lines[i]));
+        string line = appointments[i].getAppointmentString();
+        agendaFile << line << '\n';
+        index.addRecord(appointments[i], offset);
+        offset += line.length() + 1;
+    }
+    agendaFile.close();
+    index.save(path);
+
+    vector<uint32_t> order;
+    measure("ps.order", count, 1, [&]() {
+        order = index.byTime();
+    });
+
+    mt19937 random(SEED);
+    uniform_int_distribution<int> timeDist(0, 2399);
+    uniform_int_distribution<int> titleDist(0, 999);
+    vector<int> times(queries);
+    vector<string> titles(queries);
+    for (size_t i = 0; i < queries; i++) {
+        times[i] = appointments[random() % count].getTime();
+        titles[i] = "Meeting " + to_string(titleDist(random));
+    }
+
+    size_t found = 0;
+    vector<uint32_t> records;
+    vector<uint64_t> offsets;
+    measure("p.lookup", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            AgendaIndex::lookupTimes(path, times[i], times[i] + 1, 0, 10, records, offsets);
+            found += records.size();
+        }
+    });
+
+    // the file path marks the matches dead through the index, the resident path filters the vector
+    Tombstones tombstones(path);
+    tombstones.resize(count);
+    measure("delete.tombstones", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            vector<uint32_t> matches = index.findTitle(titles[i]);
+            for (size_t j = 0; j < matches.size(); j++) {
+                tombstones.mark(matches[j]);
+            }
+        }
+    });
+
+    size_t resident = min<size_t>(queries, 100);  // each one copies the whole agenda first
+    measure("delete.resident", count, resident, [&]() {
+        for (size_t i = 0; i < resident; i++) {
+            vector<Appointment> copy = appointments;
+            LogOp op = {LOG_DELETE_TITLE, titles[i]};
+            AgendaLog::apply(op, copy);
+            found += copy.size();
+        }
+    });
+    sink = sink + found + order.size();
+
+    remove(path.c_str());
+    remove(AgendaIndex::fileName(path).c_str());
+}
+
+/**
+ * Function: runProgram
+ * @brief Runs the agenda program with its output discarded, and waits for it.
+ *
+ * @param program path of the agenda program
+ * @param args the arguments after the program name
+ */
+static void runProgram(const string &program, const vector<string> &args) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        vector<char *> argv;
+        argv.push_back(const_cast<char *>(program.c_str()));
+        for (size_t i = 0; i < args.size(); i++) {
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        }
+        argv.push_back(NULL);
+        execv(program.c_str(), argv.data());
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Function: benchCommands
+ * @brief Times whole runs of the program on agenda.txt in the working directory, including loading it.
+ *
+ * @param program path of the agenda program
+ * @param count number of appointments
+ * @param runs number of runs of each command
+ */
+static void benchCommands(const string &program, size_t count, size_t runs) {
+    vector<string> lines = makeAgenda(count);
+    ofstream agendaFile("agenda.txt");
+    for (size_t i = 0; i < count; i++) {
+        agendaFile << lines[i] << "\n";
+    }
+    agendaFile.close();
+    system("rm -f agenda.txt.*");
+    runProgram(program, {"-ps"});  // builds the index
+
+    // the allocations happen in another process, so they aren't counted
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        runProgram(program, {"-ps"});
+    }
+    report("cli.ps", count, runs, elapsedNs(start), -1);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        runProgram(program, {"-p", to_string(100 + i % 12 * 100)});
+    }
+    report("cli.p", count, runs, elapsedNs(start), -1);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        runProgram(program, {"-dt", "Meeting " + to_string(i)});
+    }
+    report("cli.dt", count, runs, elapsedNs(start), -1);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        runProgram(program, {"-dm", to_string(115 + i % 12 * 100)});
+    }
+    report("cli.dm", count, runs, elapsedNs(start), -1);
+
+    // removing a duplicate makes -dd load the agenda and write the whole file back
+    double ns = 0;
+    for (size_t i = 0; i < runs; i++) {
+        runProgram(program, {"-a", lines[i]});
+        start = chrono::steady_clock::now();
+        runProgram(program, {"-dd"});
+        ns += elapsedNs(start);
+    }
+    report("cli.write", count, runs, ns, -1);
+}
+
+/**
+ * Function: benchIntervals
+ * @brief Compares interval tree overlap queries against a naive scan on a dense synthetic calendar.
+ *
+ * @param count number of appointments
+ * @param days number of days the appointments are spread over
+ * @param queries number of queries
+ */
+static void benchIntervals(size_t count, int days, size_t queries) {
+    mt19937 random(SEED);
+    uniform_int_distribution<int> dayDist(0, days - 1);
+    uniform_int_distribution<int> hourDist(7, 19);
+    uniform_int_distribution<int> quarterDist(0, 3);
+    uniform_int_distribution<int> durationDist(1, 8);
+
+    // business-hours appointments in 15 minute steps, 15 minutes to 2 hours long
+    vector<Interval> intervals(count);
+    for (size_t i = 0; i < count; i++) {
+        int64_t start = IntervalTree::toMinute(2021, 1, 1, 0) + dayDist(random) * 1440 + hourDist(random) * 60 + quarterDist(random) * 15;
+        intervals[i].start = start;
+        intervals[i].end = start + durationDist(random) * 15;
+        intervals[i].id = i;
+    }
+
+    // 90 minute windows, like "what overlaps 10:00-11:30 on some day"
+    vector<int64_t> froms(queries);
+    for (size_t i = 0; i < queries; i++) {
+        froms[i] = IntervalTree::toMinute(2021, 1, 1, 0) + dayDist(random) * 1440 + hourDist(random) * 60 + quarterDist(random) * 15;
+    }
+
+    IntervalTree tree;
+    measure("overlap.build", count, 1, [&]() {
+        tree.build(intervals);
+    });
+
+    size_t treeMatches = 0;
+    measure("overlap.tree", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            treeMatches += tree.overlapping(froms[i], froms[i] + 90).size();
+        }
+    });
+
+    size_t naiveMatches = 0;
+    measure("overlap.naive", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            for (size_t j = 0; j < count; j++) {
+                if (intervals[j].start < froms[i] + 90 && intervals[j].end > froms[i]) {
+                    naiveMatches++;
+                }
+            }
+        }
+    });
+    if (treeMatches != naiveMatches) {
+        cerr << "overlap n=" << count << " MISMATCH" << endl;
+    }
+}
+
+/**
+ * Function: benchTitleSearch
+ * @brief Compares trigram index title searches against a find over every title, on titles built from a few word lists.
+ *
+ * @param count number of appointments
+ * @param queries number of queries of each kind
+ */
+static void benchTitleSearch(size_t count, size_t queries) {
+    const char *activities[] = {"Fishing", "Lunch", "Dinner", "Meeting", "Call", "Review", "Dentist", "Gym", "Standup", "Interview"};
+    const char *names[] = {"Donald", "Billy", "Bob", "Fred", "Alice", "Maria", "Chen", "Priya", "Omar", "Sofia", "Kenji", "Lena"};
+    mt19937 random(SEED);
+    uniform_int_distribution<int> activityDist(0, 9);
+    uniform_int_distribution<int> nameDist(0, 11);
+    uniform_int_distribution<int> numberDist(0, 9999);
+
+    // like "Fishing with Donald and Billy 42", in a mix of cases
+    vector<Appointment> appointments(count);
+    vector<string> folded(count);  // what the scan searches, folded once up front so it only pays for find
+    for (size_t i = 0; i < count; i++) {
+        string title = string(activities[activityDist(random)]) + " with " + names[nameDist(random)] + " and " + names[nameDist(random)] + " " + to_string(numberDist(random));
+        if (i % 3 == 0) {
+            Appointment::foldCase(title.data(), title.length());
+        }
+        appointments[i].setTitle(title);
+        folded[i] = title;
+        Appointment::foldCase(folded[i].data(), folded[i].length());
+    }
+
+    // pieces of random titles: the last 5 to 12 chars, like "ly 4217", for substrings, and the first 6 to 14 chars,
+    // like "Fishing wi", for prefixes, which match far more titles
+    uniform_int_distribution<size_t> titleDist(0, count - 1);
+    vector<string> substrings(queries), prefixes(queries);
+    for (size_t i = 0; i < queries; i++) {
+        const string &title = folded[titleDist(random)];
+        size_t length = min<size_t>(5 + random() % 8, title.length());
+        substrings[i] = title.substr(title.length() - length);
+        prefixes[i] = title.substr(0, 6 + random() % 9);
+    }
+
+    TrigramIndex index;
+    measure("titles.build", count, 1, [&]() {
+        index.build(appointments);
+    });
+
+    size_t indexMatches = 0;
+    measure("titles.contains.index", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            indexMatches += index.containing(substrings[i]).size();
+        }
+    });
+    size_t scanMatches = 0;
+    measure("titles.contains.scan", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            for (size_t j = 0; j < count; j++) {
+                scanMatches += folded[j].find(substrings[i]) != string::npos;
+            }
+        }
+    });
+    if (indexMatches != scanMatches) {
+        cerr << "titles.contains n=" << count << " MISMATCH" << endl;
+    }
+
+    indexMatches = scanMatches = 0;
+    measure("titles.prefix.index", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            indexMatches += index.startingWith(prefixes[i]).size();
+        }
+    });
+    measure("titles.prefix.scan", count, queries, [&]() {
+        for (size_t i = 0; i < queries; i++) {
+            for (size_t j = 0; j < count; j++) {
+                scanMatches += folded[j].compare(0, prefixes[i].length(), prefixes[i]) == 0;
+            }
+        }
+    });
+    if (indexMatches != scanMatches) {
+        cerr << "titles.prefix n=" << count << " MISMATCH" << endl;
+    }
+}
+
+/**
+ * Function: benchConflicts
+ * @brief Times the sweep-line conflict detector, and a pairwise comparison on agendas small enough for it.
+ *
+ * @param count number of appointments
+ * @param days number of days the appointments are spread over
+ */
+static void benchConflicts(size_t count, int days) {
+    mt19937 random(SEED);
+    uniform_int_distribution<int> dayDist(0, days - 1);
+    uniform_int_distribution<int> minuteDist(7 * 60, 19 * 60);
+    uniform_int_distribution<int> durationDist(15, 120);
+
+    vector<Interval> intervals(count);
+    for (size_t i = 0; i < count; i++) {
+        intervals[i].start = IntervalTree::toMinute(2021, 1, 1, 0) + dayDist(random) * 1440 + minuteDist(random);
+        intervals[i].end = intervals[i].start + durationDist(random);
+        intervals[i].id = i;
+    }
+
+    vector<vector<size_t> > groups;
+    measure("conflicts.sweep", count, 1, [&]() {
+        groups = findConflicts(intervals);
+    });
+    if (count <= 20000) {
+        size_t pairs = 0;
+        measure("conflicts.pairwise", count, 1, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                for (size_t j = i + 1; j < count; j++) {
+                    if (intervals[i].start < intervals[j].end && intervals[j].start < intervals[i].end) {
+                        pairs++;
+                    }
+                }
+            }
+        });
+        sink = sink + pairs + groups.size();
+    }
+}
+
+/**
+ * Function: benchDedupe
+ * @brief Times the hashed duplicate removal, and a pairwise comparison on agendas small enough for it.
+ *
+ * @param count number of appointments
+ * @param duplicateFraction share of the appointments that copy an earlier one
+ */
+static void benchDedupe(size_t count, double duplicateFraction) {
+    mt19937 random(SEED);
+    uniform_int_distribution<int> titleDist(0, 999);
+    uniform_int_distribution<int> dayDist(1, 28);
+    uniform_int_distribution<int> monthDist(1, 12);
+    uniform_int_distribution<int> timeDist(0, 23);
+    uniform_int_distribution<int> durationDist(1, 120);
+
+    // unique appointments first, then copies of random ones, shuffled together
+    size_t uniqueCount = count - static_cast<size_t>(count * duplicateFraction);
+    vector<Appointment> appointments(count);
+    for (size_t i = 0; i < uniqueCount; i++) {
+        appointments[i].setTitle("Meeting " + to_string(titleDist(random)));
+        appointments[i].setDate(2000 + i % 50, monthDist(random), dayDist(random));
+        appointments[i].setTime(timeDist(random) * 100);
+        appointments[i].setDuration(durationDist(random));
+    }
+    uniform_int_distribution<size_t> copyDist(0, uniqueCount - 1);
+    for (size_t i = uniqueCount; i < count; i++) {
+        appointments[i] = appointments[copyDist(random)];
+    }
+    shuffle(appointments.begin(), appointments.end(), random);
+
+    vector<Appointment> exact = appointments;
+    size_t removed = 0;
+    measure("dedupe.hashed", count, 1, [&]() {
+        removed = removeDuplicates(exact, false);
+    });
+    exact.clear();
+    exact.shrink_to_fit();
+
+    // the O(n^2) scan operator == alone allows, on agendas small enough for it
+    if (count <= 20000) {
+        vector<Appointment> kept;
+        measure("dedupe.pairwise", count, 1, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                if (find(kept.begin(), kept.end(), appointments[i]) == kept.end()) {
+                    kept.push_back(appointments[i]);
+                }
+            }
+        });
+        if (count - kept.size() != removed) {
+            cerr << "dedupe n=" << count << " MISMATCH" << endl;
+        }
+    }
+
+    measure("dedupe.normalized", count, 1, [&]() {
+        removeDuplicates(appointments, true);
+    });
+}
+
+int main(int argc, char const *argv[]) {
+    string program;  // path of a.out, if the commands should be timed
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--json") {
+            jsonOutput = true;
+        }
+        else {
+            program = argv[i];
+        }
+    }
+
+    size_t sizes[] = {1000, 100000, 1000000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        benchAppointments(sizes[i]);
+        benchArena(sizes[i]);
+    }
+
+    // the files go to a scratch directory
+    char directory[] = "/tmp/agenda_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        cout << "Failed to create scratch directory." << endl;
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        benchQueries(sizes[i], 10000);
+    }
+    if (!program.empty()) {
+        benchCommands(program, 1000, 50);
+        benchCommands(program, 100000, 10);
+    }
+    string cleanup = string("rm -rf ") + directory;
+    system(cleanup.c_str());
+
+    benchIntervals(10000, 30, 1000);
+    benchIntervals(100000, 365, 1000);
+    benchIntervals(1000000, 365, 200);
+    benchTitleSearch(10000, 1000);
+    benchTitleSearch(100000, 200);
+    benchTitleSearch(1000000, 50);
+    benchConflicts(20000, 3650);
+    benchConflicts(1000000, 3650);
+    benchConflicts(10000000, 36500);
+    benchDedupe(20000, 0.3);
+    benchDedupe(1000000, 0.3);
+    benchDedupe(10000000, 0.3);
+
+    return 0;
+}
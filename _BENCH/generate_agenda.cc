@@ -0,0 +1,329 @@
+/*
+ * Deterministic generator of synthetic agendas for scale testing
+ *
+ * Usage: generate_agenda <count> [--seed N] [--titles N] [--start YYYY-MM-DD] [--days N]
+ *                        [--times business|hourly|uniform] [--duplicates FRACTION] [--quirks FRACTION]
+ *
+ * Writes count appointment lines to standard output. The same arguments always give the same bytes,
+ * on any platform, because the random numbers come from splitmix64 rather than the standard library's
+ * distributions. Lines are written like the program writes them, except for the share given by
+ * --quirks, which get the padding, meridiem spellings and leading zeros the parser also reads.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+const size_t OUTPUT_BUFFER_BYTES = 1 << 20;
+const size_t RECENT_RECORDS = 4096;  // records a duplicate can copy
+const char *TITLE_WORDS[] = {"Meeting", "Lunch", "Review", "Standup", "Call", "Interview", "Dentist", "Workout", "Planning", "Sync",
+                             "Dinner", "Seminar", "Office hours", "Haircut", "Demo", "Retrospective"};
+const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+struct Record {
+    uint32_t title;     // index of the title
+    uint32_t day;       // days after the start date
+    uint16_t minute;    // minutes after midnight
+    uint16_t duration;  // length in minutes
+};
+
+class Random {
+    public:
+        /**
+         * @brief Construct a new Random object from a seed.
+         */
+        Random(uint64_t seed) {
+            state = seed;
+        }
+
+        /**
+         * Function: next
+         * @brief Gets the next 64 random bits, by splitmix64.
+         */
+        uint64_t next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        /**
+         * Function: below
+         * @brief Gets a random number in [0, bound), by multiplying instead of dividing.
+         */
+        uint32_t below(uint32_t bound) {
+            return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+        }
+
+        /**
+         * Function: chance
+         * @brief Tells whether an event with the given probability happens.
+         */
+        bool chance(double probability) {
+            return (next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+        }
+    private:
+        uint64_t state;
+};
+
+class Output {
+    public:
+        Output() {
+            buffer.resize(OUTPUT_BUFFER_BYTES);
+            used = 0;
+        }
+
+        ~Output() {
+            flush();
+        }
+
+        /**
+         * Function: append
+         * @brief Adds bytes to the output, writing it out whenever the buffer fills.
+         */
+        void append(const char *data, size_t length) {
+            if (used + length > buffer.size()) {
+                flush();
+            }
+            memcpy(&buffer[used], data, length);
+            used += length;
+        }
+
+        void append(const char *data) {
+            append(data, strlen(data));
+        }
+
+        void append(const string &data) {
+            append(data.data(), data.length());
+        }
+
+        void append(char c) {
+            if (used == buffer.size()) {
+                flush();
+            }
+            buffer[used++] = c;
+        }
+
+        /**
+         * Function: appendNumber
+         * @brief Adds a non-negative number in decimal, padded with zeros to a width.
+         */
+        void appendNumber(uint32_t number, int width = 1) {
+            char digits[12];
+            int length = 0;
+            do {
+                digits[length++] = '0' + number % 10;
+                number /= 10;
+            } while (number > 0 || length < width);
+            while (length > 0) {
+                append(digits[--length]);
+            }
+        }
+
+        void flush() {
+            fwrite(buffer.data(), 1, used, stdout);
+            used = 0;
+        }
+    private:
+        vector<char> buffer;  // bytes not yet written
+        size_t used;          // number of bytes in the buffer
+};
+
+/**
+ * Function: parseStart
+ * @brief Reads a date in YYYY-MM-DD format.
+ *
+ * @return true if the string holds a valid date
+ */
+static bool parseStart(const string &input, int &year, int &month, int &day) {
+    return sscanf(input.c_str(), "%d-%d-%d", &year, &month, &day) == 3 && year >= 0 && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+/**
+ * Function: makeTitles
+ * @brief Makes the titles, every word paired with a number once the words run out.
+ */
+static vector<string> makeTitles(uint32_t count) {
+    const uint32_t words = sizeof(TITLE_WORDS) / sizeof(TITLE_WORDS[0]);
+    vector<string> titles(count);
+    for (uint32_t i = 0; i < count; i++) {
+        titles[i] = TITLE_WORDS[i % words];
+        if (count > words) {
+            titles[i] += " " + to_string(i / words);
+        }
+    }
+
+    return titles;
+}
+
+/**
+ * Function: makeDates
+ * @brief Gets the year, month and day of every day of the span, as year * 10000 + month * 100 + day.
+ */
+static vector<uint32_t> makeDates(int year, int month, int day, uint32_t days) {
+    vector<uint32_t> dates(days);
+    for (uint32_t i = 0; i < days; i++) {
+        dates[i] = year * 10000 + month * 100 + day;
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        if (++day > DAYS_IN_MONTH[month - 1] + (month == 2 && leap ? 1 : 0)) {
+            day = 1;
+            if (++month > 12) {
+                month = 1;
+                year++;
+            }
+        }
+    }
+
+    return dates;
+}
+
+/**
+ * Function: pickMinute
+ * @brief Picks a starting time, in minutes after midnight.
+ */
+static uint16_t pickMinute(Random &random, const string &times) {
+    if (times == "uniform") {
+        return random.below(1440);
+    }
+    if (times == "hourly") {
+        return random.below(24) * 60;
+    }
+    return 8 * 60 + random.below(40) * 15;  // business hours, 8:00AM-5:45PM in 15 minute steps
+}
+
+/**
+ * Function: writeRecord
+ * @brief Writes one appointment line, with or without the quirks the parser reads through.
+ */
+static void writeRecord(Output &output, const Record &record, const vector<string> &titles, const vector<uint32_t> &dates, Random &random, bool quirky) {
+    uint32_t date = dates[record.day];
+    uint32_t hour = record.minute / 60 % 12 == 0 ? 12 : record.minute / 60 % 12;
+    bool morning = record.minute < 720;
+
+    if (!quirky) {
+        output.append(titles[record.title]);
+        output.append('|');
+        output.appendNumber(date / 10000);
+        output.append('|');
+        output.appendNumber(date / 100 % 100);
+        output.append('|');
+        output.appendNumber(date % 100);
+        output.append('|');
+        output.appendNumber(hour);
+        output.append(':');
+        output.appendNumber(record.minute % 60, 2);
+        output.append(morning ? "AM" : "PM", 2);
+        output.append('|');
+        output.appendNumber(record.duration);
+        output.append('\n');
+        return;
+    }
+
+    // spaces around any field, zero-padded numbers, and the meridiem in any case with or without a space before it
+    const char *pads[] = {"", " ", "  ", "\t"};
+    const char *meridiems[] = {"AM", "am", "Am", "aM", "PM", "pm", "Pm", "pM"};
+    uint64_t bits = random.next();
+    output.append(pads[bits & 3]);
+    output.append(titles[record.title]);
+    output.append(pads[(bits >> 2) & 3]);
+    output.append('|');
+    output.append(pads[(bits >> 4) & 1]);
+    output.appendNumber(date / 10000);
+    output.append('|');
+    output.appendNumber(date / 100 % 100, (bits >> 5) & 1 ? 2 : 1);
+    output.append('|');
+    output.appendNumber(date % 100, (bits >> 6) & 1 ? 2 : 1);
+    output.append(pads[(bits >> 7) & 1]);
+    output.append('|');
+    output.append(pads[(bits >> 8) & 1]);
+    output.appendNumber(hour);
+    output.append(':');
+    output.appendNumber(record.minute % 60, 2);
+    output.append(pads[(bits >> 9) & 1]);
+    output.append(meridiems[(morning ? 0 : 4) + ((bits >> 10) & 3)], 2);
+    output.append('|');
+    output.appendNumber(record.duration);
+    output.append(pads[(bits >> 12) & 1]);
+    output.append('\n');
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2 || atoll(argv[1]) <= 0) {
+        cerr << "Usage: generate_agenda <count> [--seed N] [--titles N] [--start YYYY-MM-DD] [--days N]" << endl
+             << "                       [--times business|hourly|uniform] [--duplicates FRACTION] [--quirks FRACTION]" << endl;
+        return 1;
+    }
+    uint64_t count = atoll(argv[1]);
+    uint64_t seed = 2400;
+    int titleCount = 1000;
+    int year = 2021, month = 1, day = 1;
+    int days = 365;
+    string times = "business";
+    double duplicates = 0, quirks = 0;
+
+    for (int i = 2; i < argc; i += 2) {
+        string option = argv[i], value = (i + 1 < argc) ? argv[i + 1] : "";
+        bool valid = true;
+        if (option == "--seed") {
+            seed = strtoull(value.c_str(), NULL, 10);
+        }
+        else if (option == "--titles") {
+            titleCount = atoi(value.c_str());
+            valid = titleCount > 0;
+        }
+        else if (option == "--start") {
+            valid = parseStart(value, year, month, day);
+        }
+        else if (option == "--days") {
+            days = atoi(value.c_str());
+            valid = days > 0;
+        }
+        else if (option == "--times") {
+            times = value;
+            valid = times == "business" || times == "hourly" || times == "uniform";
+        }
+        else if (option == "--duplicates") {
+            duplicates = atof(value.c_str());
+            valid = duplicates >= 0 && duplicates <= 1;
+        }
+        else if (option == "--quirks") {
+            quirks = atof(value.c_str());
+            valid = quirks >= 0 && quirks <= 1;
+        }
+        else {
+            valid = false;
+        }
+
+        if (!valid) {
+            cerr << "Invalid option " << option << " " << value << endl;
+            return 1;
+        }
+    }
+
+    vector<string> titles = makeTitles(titleCount);
+    vector<uint32_t> dates = makeDates(year, month, day, days);
+    vector<Record> recent(RECENT_RECORDS);  // ring of the latest records, which duplicates copy
+    Random random(seed);
+    Output output;
+
+    for (uint64_t i = 0; i < count; i++) {
+        Record record;
+        if (i > 0 && random.chance(duplicates)) {
+            record = recent[random.below(min<uint64_t>(i, RECENT_RECORDS))];
+        }
+        else {
+            record.title = random.below(titleCount);
+            record.day = random.below(days);
+            record.minute = pickMinute(random, times);
+            record.duration = 15 * (1 + random.below(8));
+        }
+        recent[i % RECENT_RECORDS] = record;
+        writeRecord(output, record, titles, dates, random, quirks > 0 && random.chance(quirks));
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Latency of the agenda server against running the program once per request
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../agenda_server.h"
+using namespace std;
+
+const unsigned SEED = 2400;
+const size_t AGENDA_SIZE = 100000;
+const string SOCKET_FILE_NAME = "agenda.txt.sock";
+
+/**
+ * Function: elapsedNs
+ * @brief Gets the nanoseconds since a starting point.
+ */
+static double elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Function: startProgram
+ * @brief Runs the agenda program in the background with its output discarded.
+ *
+ * @param program path of the agenda program
+ * @param args the arguments after the program name
+ * @return id of the process
+ */
+static pid_t startProgram(const string &program, const vector<string> &args) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        vector<char *> argv;
+        argv.push_back(const_cast<char *>(program.c_str()));
+        for (size_t i = 0; i < args.size(); i++) {
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        }
+        argv.push_back(NULL);
+        execv(program.c_str(), argv.data());
+        _exit(127);
+    }
+
+    return pid;
+}
+
+/**
+ * Function: report
+ * @brief Prints the median and 99th percentile of a set of latencies.
+ */
+static void report(const string &name, vector<double> latencies) {
+    sort(latencies.begin(), latencies.end());
+    cout << fixed << setprecision(1) << name << " n=" << latencies.size()
+         << " p50=" << latencies[latencies.size() / 2] / 1e3 << "us"
+         << " p99=" << latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)] / 1e3 << "us" << endl;
+}
+
+/**
+ * Function: benchRequests
+ * @brief Times the same requests run once per process and sent to a running server.
+ *
+ * @param program path of the agenda program
+ * @param args the arguments of the request
+ * @param forks number of processes to run
+ * @param requests number of requests to send to the server
+ */
+static void benchRequests(const string &program, const vector<string> &args, size_t forks, size_t requests) {
+    string name = args[0];
+    vector<double> latencies;
+    for (size_t i = 0; i < forks; i++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        waitpid(startProgram(program, args), NULL, 0);
+        latencies.push_back(elapsedNs(start));
+    }
+    report(name + " fork-per-request", latencies);
+
+    pid_t server = startProgram(program, vector<string>(1, "-server"));
+    AgendaClient client;
+    for (int attempt = 0; attempt < 500 && !client.connectTo(SOCKET_FILE_NAME); attempt++) {
+        usleep(10000);  // the server is still loading the agenda
+    }
+
+    string line, response;
+    for (size_t i = 0; i < args.size(); i++) {
+        line += (i > 0 ? " \"" : "\"") + args[i] + "\"";
+    }
+    latencies.clear();
+    for (size_t i = 0; i < requests; i++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (!client.request(line, response)) {
+            cout << "Failed to reach server." << endl;
+            break;
+        }
+        latencies.push_back(elapsedNs(start));
+    }
+    report(name + " server", latencies);
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        cout << "Usage: server_bench <path of a.out>" << endl;
+        return 1;
+    }
+    string program = argv[1];
+
+    // a synthetic agenda in a scratch directory
+    char directory[] = "/tmp/agenda_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        cout << "Failed to create scratch directory." << endl;
+        return 1;
+    }
+    mt19937 random(SEED);
+    uniform_int_distribution<int> titleDist(0, 999);
+    uniform_int_distribution<int> monthDist(1, 12);
+    uniform_int_distribution<int> dayDist(1, 28);
+    uniform_int_distribution<int> hourDist(1, 12);
+    uniform_int_distribution<int> durationDist(1, 120);
+    ofstream agendaFile("agenda.txt");
+    for (size_t i = 0; i < AGENDA_SIZE; i++) {
+        agendaFile << "Meeting " << titleDist(random) << "|2021|" << monthDist(random) << "|" << dayDist(random) << "|"
+                   << hourDist(random) << ":00 " << (i % 2 == 0 ? "AM" : "PM") << "|" << durationDist(random) << "\n";
+    }
+    agendaFile.close();
+    cout << "agenda n=" << AGENDA_SIZE << endl;
+
+    benchRequests(program, {"-p", "1300", "--limit", "5"}, 200, 2000);
+    benchRequests(program, {"-a", "Standup|2021|12|1|9:00 AM|15"}, 200, 2000);
+
+    string cleanup = string("rm -rf ") + directory;
+    return system(cleanup.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/*
+ * Throughput of concurrent processes changing one agenda, and whether any of their changes were lost
+ */
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace std;
+
+const unsigned SEED = 2400;
+const size_t AGENDA_SIZE = 20000;
+const int ROUNDS = 20;  // rounds of changes made by each writer
+
+/**
+ * Function: runProgram
+ * @brief Runs the agenda program with its output discarded, and waits for it.
+ *
+ * @param program path of the agenda program
+ * @param args the arguments after the program name
+ */
+static void runProgram(const string &program, const vector<string> &args) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        vector<char *> argv;
+        argv.push_back(const_cast<char *>(program.c_str()));
+        for (size_t i = 0; i < args.size(); i++) {
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        }
+        argv.push_back(NULL);
+        execv(program.c_str(), argv.data());
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Function: writeAgenda
+ * @brief Writes a synthetic agenda to agenda.txt, replacing the files left by an earlier run.
+ */
+static void writeAgenda() {
+    system("rm -f agenda.txt.*");
+    mt19937 random(SEED);
+    uniform_int_distribution<int> monthDist(1, 12);
+    uniform_int_distribution<int> dayDist(1, 28);
+    uniform_int_distribution<int> hourDist(1, 12);
+    uniform_int_distribution<int> durationDist(1, 120);
+    ofstream agendaFile("agenda.txt");
+    for (size_t i = 0; i < AGENDA_SIZE; i++) {
+        agendaFile << "Meeting " << i << "|2021|" << monthDist(random) << "|" << dayDist(random) << "|"
+                   << hourDist(random) << ":00 " << (i % 2 == 0 ? "AM" : "PM") << "|" << durationDist(random) << "\n";
+    }
+}
+
+/**
+ * Function: countWriterAppointments
+ * @brief Counts the appointments the writers left in the agenda.
+ */
+static size_t countWriterAppointments(const string &program) {
+    string command = program + " -ps";
+    FILE *output = popen(command.c_str(), "r");
+    size_t count = 0;
+    char line[256];
+    while (output != NULL && fgets(line, sizeof(line), output) != NULL) {
+        count += string(line).compare(0, 7, "Writer ") == 0;
+    }
+    if (output != NULL) {
+        pclose(output);
+    }
+
+    return count;
+}
+
+/**
+ * Function: benchWriters
+ * @brief Times writers that each add an appointment twice and remove the duplicate, every round.
+ *
+ * Removing duplicates rewrites the agenda file, so a writer that doesn't exclude the others saves
+ * over the appointments they added since it loaded the agenda.
+ *
+ * @param program path of the agenda program
+ * @param writers number of processes changing the agenda at once
+ */
+static void benchWriters(const string &program, int writers) {
+    writeAgenda();
+    runProgram(program, vector<string>(1, "-ps"));  // builds the index, so every run starts from the same files
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<pid_t> pids;
+    for (int w = 0; w < writers; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            for (int i = 0; i < ROUNDS; i++) {
+                string added = "Writer " + to_string(w) + " " + to_string(i) + "|2021|12|1|9:00 AM|15";
+                runProgram(program, {"-a", added});
+                runProgram(program, {"-a", added});
+                runProgram(program, {"-dd"});
+            }
+            _exit(0);
+        }
+        pids.push_back(pid);
+    }
+    for (size_t i = 0; i < pids.size(); i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t expected = writers * ROUNDS;
+    size_t found = countWriterAppointments(program);
+    cout << fixed << setprecision(1) << "writers=" << writers << " commands=" << expected * 3
+         << " throughput=" << expected * 3 / seconds << "/s"
+         << " lost=" << (found < expected ? expected - found : 0) << endl;
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        cout << "Usage: writers_bench <path of a.out>" << endl;
+        return 1;
+    }
+    string program = argv[1];
+
+    // the agenda lives in a scratch directory
+    char directory[] = "/tmp/agenda_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        cout << "Failed to create scratch directory." << endl;
+        return 1;
+    }
+    cout << "agenda n=" << AGENDA_SIZE << " rounds=" << ROUNDS << endl;
+
+    int counts[] = {1, 2, 4, 8};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        benchWriters(program, counts[i]);
+    }
+
+    string cleanup = string("rm -rf ") + directory;
+    return system(cleanup.c_str()) == 0 ? 0 : 1;
+}
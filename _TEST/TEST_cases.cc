@@ -5,6 +5,30 @@
 #define CATCH_CONFIG_MAIN  // Catch supplies a main program
 #include "catch.hpp"
 #include "../appointment.h"
+#include "../agenda_index.h"
+#include "../agenda_log.h"
+#include "../agenda_tombstones.h"
+#include "../agenda_command.h"
+#include "../agenda_dedupe.h"
+#include "../agenda_arena.h"
+#include "../agenda_load.h"
+#include "../agenda_lock.h"
+#include "../agenda_server.h"
+#include "../agenda_shards.h"
+#include "../agenda_snapshots.h"
+#include "../agenda_stats.h"
+#include "../agenda_trace.h"
+#include "../interval_tree.h"
+#include "../schedule.h"
+#include "../trigram_index.h"
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <unistd.h>
+#include <csignal>
+#include <pthread.h>
+#include <sys/stat.h>
 
 const int MAX_SCORE = 55;
 static int score = 0;
@@ -103,3 +127,1003 @@ TEST_CASE("Testing  Appointment Class") {
     }
 }
 
+TEST_CASE("Testing Appointment Views") {
+    Appointment a("  Meeting with Bob |2019|4|29|8:30 AM|15|extra");
+
+    SECTION("Parsing In Place") {
+        REQUIRE("Meeting with Bob" == a.getTitle());
+        REQUIRE(a.getTitle().data() == a.getTitle().data());  // no copy per call
+        REQUIRE(15 == a.getDuration());           // the last parameter runs to the end of the line
+        REQUIRE("Meeting" == a.trimSpaces(" \tMeeting  "));
+        REQUIRE(a.trimSpaces("   ").empty());
+        REQUIRE(42 == a.toInt("  42abc"));
+        REQUIRE(-1 == a.toInt("99999999999"));
+        REQUIRE(1 == Appointment("X|99999999999|4|1|1:00 PM|5").getYear());  // too big for an int, so the default stays
+    }
+
+    SECTION("Appending") {
+        string output = "> ";
+        a.appendAppointmentString(output);
+        REQUIRE("> Meeting with Bob|2019|4|29|8:30AM|15" == output);
+        output.clear();
+        a.appendDate(output);
+        a.appendStandardTime(5, output);
+        REQUIRE("2019-04-2912:05AM" == output);
+    }
+
+    SECTION("Setting Titles") {
+        a.setTitle(string("  Lunch with a title too long for the short string buffer  "));
+        REQUIRE("Lunch with a title too long for the short string buffer" == a.getTitle());
+
+        // a moved title from the same resource keeps its storage
+        pmr::string moved("Dinner with a title too long for the short string buffer  ");
+        const char *storage = moved.data();
+        a.setTitle(move(moved));
+        REQUIRE("Dinner with a title too long for the short string buffer" == a.getTitle());
+        REQUIRE(storage == a.getTitle().data());
+        REQUIRE(Appointment::foldedHash("DINNER WITH A TITLE TOO LONG FOR THE SHORT STRING BUFFER") == a.getTitleKey());
+    }
+}
+
+TEST_CASE("Testing Folded Titles") {
+    Appointment a("Fishing with Donald and Donald|2021|10|29|12:30 PM|60");
+
+    SECTION("Folding") {
+        string text = "az AZ @[`{ 09 caf\xc3\xa9 long enough for two words";
+        Appointment::foldCase(&text[0], text.length());
+        REQUIRE("AZ AZ @[`{ 09 CAF\xc3\xa9 LONG ENOUGH FOR TWO WORDS" == text);  // only ASCII letters change
+        REQUIRE("MEETING WITH BOB" == a.stringToUpper("Meeting with Bob"));
+        REQUIRE(Appointment::equalsIgnoringCase("Fishing With DONALD and donald", a.getTitle()));
+        REQUIRE_FALSE(Appointment::equalsIgnoringCase("Fishing with Donald and Donalds", a.getTitle()));
+        REQUIRE_FALSE(Appointment::equalsIgnoringCase("Fishing with Donald and Ronald", a.getTitle()));
+    }
+
+    SECTION("Keys") {
+        REQUIRE(Appointment::foldedHash("FISHING WITH DONALD AND DONALD") == a.getTitleKey());
+        REQUIRE(AgendaIndex::hashTitle("fishing with donald and donald") == a.getTitleKey());
+        REQUIRE(a.matchesTitle("fishing with DONALD and Donald", Appointment::foldedHash("fishing with DONALD and Donald")));
+        REQUIRE_FALSE(a.matchesTitle("Fishing with Donald", Appointment::foldedHash("Fishing with Donald")));
+        a.setTitle("Lunch");
+        REQUIRE(Appointment::foldedHash("LUNCH") == a.getTitleKey());
+        REQUIRE(Appointment::foldedHash("N/A") == Appointment().getTitleKey());
+    }
+
+    SECTION("Deleting In Any Case") {
+        vector<Appointment> appointments;
+        appointments.push_back(a);
+        appointments.push_back(Appointment("FISHING WITH DONALD AND DONALD|2021|10|30|8:00 AM|30"));
+        appointments.push_back(Appointment("Fishing with Donald|2021|10|30|9:00 AM|30"));
+        AgendaLog::apply({LOG_DELETE_TITLE, "fishing with donald and donald"}, appointments);
+        REQUIRE(3 == appointments.size());
+        AgendaLog::apply({LOG_DELETE_TITLE_IGNORING_CASE, "fishing with donald and donald"}, appointments);
+        REQUIRE(1 == appointments.size());
+        REQUIRE("Fishing with Donald" == appointments[0].getTitle());
+
+        AgendaIndex index;
+        index.addRecord(a, 0);
+        index.addRecord(Appointment("fishing WITH donald AND donald|2021|10|30|8:00 AM|30"), 52);
+        REQUIRE(2 == index.findTitle("Fishing with Donald and Donald").size());
+    }
+}
+
+TEST_CASE("Testing AgendaArena Class") {
+    const string line = "Quarterly planning meeting with the whole team|2021|10|29|12:30 PM|60";
+    AgendaArena arena;
+
+    SECTION("Titles From Few Blocks") {
+        pmr::memory_resource *part = arena.addPart(64000);
+        vector<Appointment> appointments;
+        for (int i = 0; i < 1000; i++) {
+            appointments.emplace_back(line, part);  // moved along as the vector grows, titles and all
+        }
+        REQUIRE(1 == arena.blockCount());
+        REQUIRE(64000 <= arena.blockBytes());
+        REQUIRE(Appointment(line) == appointments[999]);
+        appointments.clear();
+        REQUIRE(1 == arena.blockCount());
+    }
+
+    SECTION("Copies Leave The Arena") {
+        Appointment inArena(line, arena.addPart(64));
+        Appointment copy = inArena;
+        REQUIRE(inArena == copy);
+        copy.setTitle(string(200, 'x'));
+        REQUIRE(1 == arena.blockCount());  // the copy's title came from the default resource
+        inArena.setTitle(string(200, 'y'));
+        REQUIRE(2 == arena.blockCount());  // a new title stays in the arena, which needs another block for it
+    }
+}
+
+// counts its allocations; as the default resource, it sees every title a copy of an appointment allocates
+struct CountingResource : pmr::memory_resource {
+    atomic<size_t> allocations{0};
+
+    void *do_allocate(size_t size, size_t alignment) override {
+        allocations++;
+        return pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *block, size_t size, size_t alignment) override {
+        pmr::new_delete_resource()->deallocate(block, size, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_CASE("Testing Agenda Loading") {
+    static CountingResource counting;  // outlives the test, in case a failed check skips restoring the default
+    const string path = "_TEST/load-test-agenda.txt";
+    string contents;
+    for (int i = 0; i < 100; i++) {
+        contents += "Quarterly planning meeting number " + to_string(i) + "|2021|10|29|12:30 PM|60\n";
+    }
+    contents += "   \n";
+    Tombstones tombstones(path);
+    tombstones.resize(100);
+    tombstones.mark(3);
+    vector<Appointment> appointments;
+    AgendaIndex index;
+    counting.allocations = 0;
+
+    SECTION("No Copies") {
+        pmr::memory_resource *previous = pmr::set_default_resource(&counting);
+        size_t lines = parseAgenda(contents, tombstones, NULL, appointments, index);
+        AgendaLog::apply({LOG_ADD, "Quarterly planning meeting moved|2021|10|30|1:00 PM|60"}, appointments);
+        pmr::set_default_resource(previous);
+
+        REQUIRE(101 == lines);
+        REQUIRE(100 == index.size());
+        REQUIRE(100 == appointments.size());
+        REQUIRE("Quarterly planning meeting number 4" == appointments[3].getTitle());
+        REQUIRE(101 == counting.allocations);  // one per title, none for copies of appointments
+    }
+
+    SECTION("No Copies Out Of The Arena") {
+        AgendaArena arena;
+        pmr::memory_resource *previous = pmr::set_default_resource(&counting);
+        parseAgenda(contents, tombstones, &arena, appointments, index);
+        pmr::set_default_resource(previous);
+
+        REQUIRE(99 == appointments.size());
+        REQUIRE(0 == counting.allocations);
+        REQUIRE(1 == arena.blockCount());
+        appointments.clear();  // before the arena the titles came from
+    }
+}
+
+TEST_CASE("Testing AgendaIndex Class") {
+    SECTION("Time Ordering") {
+        AgendaIndex index;
+        index.addRecord(Appointment("Lunch|2021|10|29|12:30 PM|60"), 0);
+        index.addRecord(Appointment("Breakfast|2021|10|28|8:00 AM|30"), 29);
+        index.addRecord(Appointment("Lunch again|2021|10|30|12:30 PM|60"), 60);
+
+        vector<uint32_t> order = index.byTime();
+        REQUIRE(3 == order.size());
+        REQUIRE(1 == order[0]);
+        REQUIRE(0 == order[1]);
+        REQUIRE(2 == order[2]);
+
+        order = index.byDate();
+        REQUIRE(1 == order[0]);
+        REQUIRE(0 == order[1]);
+        REQUIRE(2 == order[2]);
+        REQUIRE(20211028 == index.getFirstDate());
+        REQUIRE(20211030 == index.getLastDate());
+    }
+
+    SECTION("Index File Freshness") {
+        const string path = "_TEST/index-test-agenda.txt";
+        ofstream agendaFile(path);
+        agendaFile << "Lunch|2021|10|29|12:30 PM|60\nBreakfast|2021|10|28|8:00 AM|30\n";
+        agendaFile.close();
+
+        AgendaIndex index;
+        index.addRecord(Appointment("Lunch|2021|10|29|12:30 PM|60"), 0);
+        index.addRecord(Appointment("Breakfast|2021|10|28|8:00 AM|30"), 29);
+        REQUIRE(index.save(path));
+        REQUIRE(AgendaIndex::isFresh(path));
+
+        vector<uint32_t> records;
+        vector<uint64_t> offsets;
+        REQUIRE(AgendaIndex::lookupTimes(path, 800, 801, 0, 10, records, offsets));
+        REQUIRE(1 == offsets.size());
+        REQUIRE(1 == records[0]);
+        REQUIRE(29 == offsets[0]);
+        REQUIRE(AgendaIndex::lookupTimes(path, 0, TIME_BUCKETS, 1, 10, records, offsets));
+        REQUIRE(1 == offsets.size());
+        REQUIRE(0 == records[0]);
+        REQUIRE(0 == offsets[0]);
+
+        REQUIRE(AgendaIndex::lookupDates(path, AgendaIndex::chronoKey(20211028, 0), AgendaIndex::chronoKey(20211029, 1230), 0, 10, records, offsets));
+        REQUIRE(2 == records.size());
+        REQUIRE(1 == records[0]);
+        REQUIRE(0 == records[1]);
+        REQUIRE(AgendaIndex::lookupDates(path, AgendaIndex::chronoKey(20211029, 0), AgendaIndex::chronoKey(20211029, 1229), 0, 10, records, offsets));
+        REQUIRE(records.empty());
+
+        uint64_t offset;
+        REQUIRE(AgendaIndex::lookupRecord(path, 1, offset));
+        REQUIRE(29 == offset);
+        REQUIRE(false == AgendaIndex::lookupRecord(path, 2, offset));
+
+        // any change to the agenda makes the index stale
+        agendaFile.open(path, ios::app);
+        agendaFile << "Dinner|2021|10|29|6:00 PM|60\n";
+        agendaFile.close();
+        REQUIRE(false == AgendaIndex::isFresh(path));
+        REQUIRE(false == index.load(path));
+
+        remove(path.c_str());
+        remove(AgendaIndex::fileName(path).c_str());
+    }
+}
+
+TEST_CASE("Testing AgendaLog Class") {
+    const string path = "_TEST/log-test-agenda.txt";
+    ofstream agendaFile(path);
+    agendaFile << "Lunch|2021|10|29|12:30 PM|60\nBreakfast|2021|10|28|8:00 AM|30\n";
+    agendaFile.close();
+    remove(AgendaLog::fileName(path).c_str());
+
+    SECTION("Replay") {
+        AgendaLog log(path);
+        REQUIRE(log.append(LOG_ADD, "Dinner|2021|10|29|6:00PM|60"));
+        REQUIRE(log.append(LOG_DELETE_TITLE, "Lunch"));
+        REQUIRE(log.append(LOG_ADD, "Brunch|2021|10|30|10:00AM|60"));
+        REQUIRE(log.append(LOG_DELETE_TIME, "800"));
+
+        // a record cut short by a crash is ignored
+        ofstream logFile(AgendaLog::fileName(path), ios::app);
+        logFile << "A|Torn|2021|10";
+        logFile.close();
+
+        REQUIRE(log.read());
+        vector<Appointment> appointments;
+        appointments.push_back(Appointment("Lunch|2021|10|29|12:30 PM|60"));
+        appointments.push_back(Appointment("Breakfast|2021|10|28|8:00 AM|30"));
+        log.replay(appointments);
+
+        REQUIRE(2 == appointments.size());
+        REQUIRE("Dinner" == appointments[0].getTitle());
+        REQUIRE("Brunch" == appointments[1].getTitle());
+
+        // and cut off before the next record, which would otherwise run into it
+        REQUIRE(log.append(LOG_ADD, "Supper|2021|10|30|6:00PM|60"));
+        REQUIRE(log.read());
+        appointments.clear();
+        log.replay(appointments);
+        REQUIRE(3 == appointments.size());
+        REQUIRE("Supper" == appointments[2].getTitle());
+        ifstream readBack(AgendaLog::fileName(path), ios::binary);
+        string contents((istreambuf_iterator<char>(readBack)), istreambuf_iterator<char>());
+        REQUIRE(string::npos == contents.find("Torn"));
+    }
+
+    SECTION("Touched Agenda") {
+        AgendaLog log(path);
+        REQUIRE(log.append(LOG_DELETE_TITLE, "Lunch"));
+        REQUIRE(AgendaLog::fitsAgenda(path));
+
+        // editing the agenda file makes the log stale: it is kept, but not replayed onto the new contents
+        agendaFile.open(path, ios::app);
+        agendaFile << "Lunch|2021|10|30|12:30 PM|60\n";
+        agendaFile.close();
+        REQUIRE(false == AgendaLog::fitsAgenda(path));
+        REQUIRE(false == log.read());
+        REQUIRE(log.isStale());
+        REQUIRE(log.empty());
+        REQUIRE(false == log.append(LOG_ADD, "Dinner|2021|10|29|6:00PM|60"));
+        REQUIRE(0 < log.size());
+
+        // a log started after the edit is tied to the new contents
+        log.clear();
+        REQUIRE(log.append(LOG_ADD, "Dinner|2021|10|29|6:00PM|60"));
+        REQUIRE(log.read());
+        REQUIRE(false == log.isStale());
+        vector<Appointment> appointments;
+        log.replay(appointments);
+        REQUIRE(1 == appointments.size());
+        REQUIRE("Dinner" == appointments[0].getTitle());
+    }
+
+    SECTION("Commit") {
+        AgendaLog log(path);
+        REQUIRE(log.append(LOG_DELETE_TIME, "800"));
+        const string writtenPath = path + ".tmp";
+        ofstream writtenFile(writtenPath);
+        writtenFile << "Lunch|2021|10|29|12:30 PM|60\n";
+        writtenFile.close();
+
+        // a pending file left while the log still exists was never committed
+        rename(writtenPath.c_str(), AgendaLog::pendingName(path).c_str());
+        REQUIRE(log.read());
+        REQUIRE(false == ifstream(AgendaLog::pendingName(path)).good());
+
+        // one left after the log was removed was, and takes the agenda file's place
+        writtenFile.open(AgendaLog::pendingName(path));
+        writtenFile << "Lunch|2021|10|29|12:30 PM|60\n";
+        writtenFile.close();
+        remove(AgendaLog::fileName(path).c_str());
+        REQUIRE(false == log.read());
+        REQUIRE(false == ifstream(AgendaLog::pendingName(path)).good());
+        ifstream committed(path);
+        string lineIn;
+        REQUIRE(getline(committed, lineIn));
+        REQUIRE("Lunch|2021|10|29|12:30 PM|60" == lineIn);
+        REQUIRE(false == bool(getline(committed, lineIn)));
+        committed.close();
+
+        REQUIRE(log.append(LOG_DELETE_TIME, "1230"));
+        writtenFile.open(writtenPath);
+        writtenFile.close();
+        REQUIRE(AgendaLog::commitAgenda(path, writtenPath));
+        REQUIRE(false == log.read());
+        REQUIRE(0 == log.size());
+    }
+
+    remove(path.c_str());
+    remove(AgendaLog::fileName(path).c_str());
+}
+
+TEST_CASE("Testing Tombstones Class") {
+    const string path = "_TEST/tombstones-test-agenda.txt";
+    ofstream agendaFile(path);
+    agendaFile << "Lunch|2021|10|29|12:30 PM|60\nBreakfast|2021|10|28|8:00 AM|30\nDinner|2021|10|29|6:00 PM|60\n";
+    agendaFile.close();
+
+    Tombstones tombstones(path);
+    tombstones.resize(5);
+    REQUIRE(tombstones.mark(1));
+    REQUIRE(false == tombstones.mark(1));
+    REQUIRE(tombstones.save());
+
+    Tombstones reread(path);
+    REQUIRE(reread.read());
+    REQUIRE(1 == reread.deadCount());
+    REQUIRE(reread.isDead(1));
+    REQUIRE(false == reread.isDead(0));
+    REQUIRE(false == reread.isDead(2));
+    REQUIRE(reread.deadFraction() < DEAD_COMPACT_FRACTION);
+    REQUIRE(reread.mark(2));
+    REQUIRE(reread.deadFraction() > DEAD_COMPACT_FRACTION);
+
+    REQUIRE(reread.isCurrent());
+
+    // changing the agenda file or logging an operation makes the bitmap stale, but keeps the file
+    agendaFile.open(path);
+    agendaFile << "Lunch|2021|10|29|12:30 PM|60\n";
+    agendaFile.close();
+    REQUIRE(false == reread.read());
+    REQUIRE(false == reread.isCurrent());
+    REQUIRE(0 == reread.deadCount());
+    REQUIRE(ifstream(Tombstones::fileName(path)).good());
+    REQUIRE(reread.save());
+    AgendaLog log(path);
+    REQUIRE(log.append(LOG_DELETE_TIME, "1230"));
+    REQUIRE(false == reread.read());
+    REQUIRE(false == reread.isCurrent());
+    REQUIRE(log.read());
+    REQUIRE(false == log.coveredBy(reread));
+    REQUIRE(reread.save());
+    REQUIRE(log.coveredBy(reread));
+
+    log.clear();
+    remove(path.c_str());
+    remove(Tombstones::fileName(path).c_str());
+}
+
+TEST_CASE("Testing AgendaLock Class") {
+    const string path = "_TEST/lock-test-agenda.txt";
+    AgendaLock first(path), second(path);
+
+    // readers share the lock, but a writer excludes everyone else
+    REQUIRE(first.lock(false, false));
+    REQUIRE(second.lock(false, false));
+    REQUIRE(false == second.lock(true, false));
+    first.unlock();
+    REQUIRE(second.lock(true, false));
+    REQUIRE(false == first.lock(false, false));
+    second.unlock();
+    REQUIRE(first.lock(true, false));
+    first.unlock();
+
+    remove(AgendaLock::fileName(path).c_str());
+}
+
+TEST_CASE("Testing Agenda Server") {
+    const string socketPath = "_TEST/server-test.sock";
+    const string output = "first\n.starts with a period\n.\n..\nlast";  // a lone period would end the response early
+
+    // one connection at a time, so the second client has to wait for the first to hang up
+    atomic<int> handled(0);
+    thread server([&socketPath, &output, &handled]() {
+        serveRequests(socketPath, [&output, &handled](const string &line) {
+            handled++;
+            return line == "echo" ? output : line;
+        }, 1);
+    });
+
+    AgendaClient *first = new AgendaClient();
+    while (!first->connectTo(socketPath)) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    string response;
+    REQUIRE(first->request("echo", response));
+    REQUIRE(output + "\n" == response);  // the periods are unstuffed, and the last line gets its newline
+    REQUIRE(first->request("", response));
+    REQUIRE(response.empty());
+
+    atomic<bool> answered(false);
+    thread second([&socketPath, &answered]() {
+        AgendaClient client;
+        string secondResponse;
+        if (client.connectTo(socketPath) && client.request("second", secondResponse) && secondResponse == "second\n") {
+            answered = true;
+        }
+    });
+    this_thread::sleep_for(chrono::milliseconds(300));
+    REQUIRE(false == answered);
+    REQUIRE(2 == handled);
+    delete first;
+    second.join();
+    REQUIRE(answered);
+
+    // a request can't hold a newline, and one longer than the limit is hung up on
+    AgendaClient third;
+    REQUIRE(third.connectTo(socketPath));
+    REQUIRE(false == third.request("first\nsecond", response));
+    REQUIRE(false == third.request(string(SERVER_MAX_LINE_BYTES + 1, 'x'), response));
+    REQUIRE(3 == handled);
+
+    // the server waits for SIGINT or SIGTERM, which only interrupts its accept call on its own thread
+    pthread_kill(server.native_handle(), SIGTERM);
+    server.join();
+    REQUIRE(false == ifstream(socketPath).good());
+}
+
+TEST_CASE("Testing Agenda Shards") {
+    const string path = "_TEST/shards-test-agenda.txt";
+    REQUIRE(false == isSharded(path));
+    REQUIRE(listShards(path).empty());
+
+    mkdir(shardDirectory(path).c_str(), 0755);
+    int keys[] = {shardKey(2021, 11), shardKey(2020, 12), shardKey(2021, 1)};
+    for (int i = 0; i < 3; i++) {
+        ofstream(shardPath(path, keys[i])).close();
+        ofstream(AgendaIndex::fileName(shardPath(path, keys[i]))).close();  // sidecars aren't shards
+    }
+    REQUIRE(isSharded(path));
+    REQUIRE(shardDirectory(path) + "/2020-12.txt" == shardPath(path, shardKey(2020, 12)));
+
+    // shards come back in month order, and a range only keeps the months in it
+    vector<string> shards = listShards(path);
+    REQUIRE(3 == shards.size());
+    REQUIRE(shardPath(path, shardKey(2020, 12)) == shards[0]);
+    REQUIRE(shardPath(path, shardKey(2021, 11)) == shards[2]);
+    shards = listShards(path, shardKey(2021, 1), shardKey(2021, 10));
+    REQUIRE(1 == shards.size());
+    REQUIRE(shardPath(path, shardKey(2021, 1)) == shards[0]);
+
+    for (int i = 0; i < 3; i++) {
+        removeShard(shardPath(path, keys[i]));
+    }
+    rmdir(shardDirectory(path).c_str());
+    REQUIRE(false == isSharded(path));
+
+    // a delete runs on every shard, but only writes a log and a bitmap where it matched
+    const string directory = "_TEST/shards-test";
+    mkdir(directory.c_str(), 0755);
+    ofstream agendaFile(directory + "/agenda.txt");
+    for (int day = 1; day <= 4; day++) {
+        agendaFile << "Meeting|2021|10|" << day << "|9:00 AM|60\n";  // enough that one delete doesn't rewrite the shard
+    }
+    agendaFile << "Lunch|2021|10|29|12:30 PM|60\nBreakfast|2021|11|28|8:00 AM|30\n";
+    agendaFile.close();
+    REQUIRE(0 == system(("cd " + directory + " && ../../a.out -shard > /dev/null && ../../a.out -dt Nobody > /dev/null && ../../a.out -dt Lunch > /dev/null").c_str()));
+    string october = shardPath(directory + "/agenda.txt", shardKey(2021, 10));
+    string november = shardPath(directory + "/agenda.txt", shardKey(2021, 11));
+    REQUIRE(ifstream(AgendaLog::fileName(october)).good());
+    REQUIRE(ifstream(Tombstones::fileName(october)).good());
+    REQUIRE(false == ifstream(AgendaLog::fileName(november)).good());
+    REQUIRE(false == ifstream(Tombstones::fileName(november)).good());
+
+    removeShard(october);
+    removeShard(november);
+    rmdir(shardDirectory(directory + "/agenda.txt").c_str());
+    const char *files[] = {"agenda.txt", "agenda.txt.idx", "agenda.txt.lock"};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        remove((directory + "/" + files[i]).c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+TEST_CASE("Testing Deduplication") {
+    SECTION("Hashing") {
+        Appointment a(" Meeting with Bob|2019|4|29|8:30 AM|15 ");
+        Appointment b(" Meeting with Bob |2019 |4|29|8:30AM|15 ");
+
+        REQUIRE(hash<Appointment>()(a) == hash<Appointment>()(b));
+    }
+
+    SECTION("Remove Duplicates") {
+        vector<Appointment> appointments;
+        appointments.push_back(Appointment("Meeting with Bob|2019|4|29|8:30 AM|15"));
+        appointments.push_back(Appointment("MEETING  with bob|2019|4|29|8:30 AM|15"));
+        appointments.push_back(Appointment("Meeting with Bob|2019|4|29|8:30 AM|15"));
+        appointments.push_back(Appointment("Lunch|2019|4|29|12:00 PM|60"));
+
+        REQUIRE("MEETING WITH BOB" == normalizeTitle("  meeting \t with  Bob "));
+
+        vector<Appointment> exact = appointments;
+        REQUIRE(1 == removeDuplicates(exact, false));
+        REQUIRE(3 == exact.size());
+        REQUIRE("MEETING  with bob" == exact[1].getTitle());
+        REQUIRE("Lunch" == exact[2].getTitle());
+
+        REQUIRE(2 == removeDuplicates(appointments, true));
+        REQUIRE(2 == appointments.size());
+        REQUIRE("Meeting with Bob" == appointments[0].getTitle());
+        REQUIRE("Lunch" == appointments[1].getTitle());
+    }
+}
+
+TEST_CASE("Testing Batch Commands") {
+    SECTION("Splitting") {
+        vector<string> args = splitCommand("  -a \"Lunch | 2021\"'|10'  '' x\"y\"z # ");
+        REQUIRE(5 == args.size());
+        REQUIRE("-a" == args[0]);
+        REQUIRE("Lunch | 2021|10" == args[1]);
+        REQUIRE("" == args[2]);  // an empty quoted span is still an argument
+        REQUIRE("xyz" == args[3]);
+        REQUIRE("#" == args[4]);
+        REQUIRE(splitCommand(" \t ").empty());
+    }
+
+    SECTION("Quoting Round Trips") {
+        vector<string> args = {"plain", "with space", "", "say \"hi\"", "it's", "\"", "''", "trailing\\", "\\\"\\", "tab\there"};
+        string line;
+        for (size_t i = 0; i < args.size(); i++) {
+            REQUIRE(vector<string>(1, args[i]) == splitCommand(quoteArgument(args[i])));
+            line += (i > 0 ? " " : "") + quoteArgument(args[i]);
+        }
+        REQUIRE(args == splitCommand(line));
+    }
+
+    SECTION("Running A Script") {
+        // the script runs against a copy of the agenda in a directory of its own, like a user's
+        const string directory = "_TEST/batch-test";
+        mkdir(directory.c_str(), 0755);
+        ofstream agendaFile(directory + "/agenda.txt");
+        agendaFile << "Lunch|2021|10|29|12:30 PM|60\nBreakfast|2021|10|28|8:00 AM|30\n";
+        agendaFile.close();
+        ofstream script(directory + "/script.txt");
+        script << "# adds, finds and deletes\n\n-a " << quoteArgument("Dinner with \"Al\"|2021|10|29|6:00 PM|60") << "\n-p 1800\n-dt Lunch\n-ps\n";
+        script.close();
+
+        REQUIRE(0 == system(("cd " + directory + " && ../../a.out -b script.txt > out.txt 2> /dev/null").c_str()));
+        ifstream output(directory + "/out.txt");
+        vector<string> lines;
+        string lineIn;
+        while (getline(output, lineIn)) {
+            lines.push_back(lineIn);
+        }
+        output.close();
+        REQUIRE(3 == lines.size());
+        REQUIRE("Dinner with \"Al\"|2021|10|29|6:00PM|60" == lines[0]);
+        REQUIRE("Breakfast|2021|10|28|8:00AM|30" == lines[1]);
+        REQUIRE("Dinner with \"Al\"|2021|10|29|6:00PM|60" == lines[2]);
+
+        // the changes are written to the agenda file once, at the end
+        ifstream written(directory + "/agenda.txt");
+        lines.clear();
+        while (getline(written, lineIn)) {
+            lines.push_back(lineIn);
+        }
+        written.close();
+        REQUIRE(2 == lines.size());
+        REQUIRE(false == ifstream(AgendaLog::fileName(directory + "/agenda.txt")).good());
+
+        const char *files[] = {"agenda.txt", "agenda.txt.idx", "agenda.txt.lock", "script.txt", "out.txt"};
+        for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+            remove((directory + "/" + files[i]).c_str());
+        }
+        rmdir(directory.c_str());
+    }
+}
+
+TEST_CASE("Testing AgendaSnapshots Class") {
+    vector<Appointment> appointments;
+    for (int i = 0; i < 1000; i++) {
+        appointments.push_back(Appointment("Meeting " + to_string(i) + "|2021|10|29|" + to_string(i % 12 + 1) + ":00 PM|15"));
+    }
+    AgendaSnapshots versions;
+    versions.reset(appointments);
+
+    SECTION("Time Ordering") {
+        versions.change([](Snapshot &next) {
+            next.add(Appointment("Early|2021|10|29|8:00 AM|15"));
+            return true;
+        });
+        vector<Appointment> page;
+        versions.current()->page(0, 1200, 0, 10, page);
+        REQUIRE(1 == page.size());
+        REQUIRE("Early" == page[0].getTitle());
+
+        versions.change([](Snapshot &next) {
+            LogOp op = {LOG_DELETE_TIME, "1300"};
+            vector<Appointment> all;
+            next.collect(all);
+            AgendaLog::apply(op, all);
+            next.replace(all);
+            return true;
+        });
+        page.clear();
+        versions.current()->page(1300, 1400, 0, SIZE_MAX, page);
+        REQUIRE(page.empty());
+        versions.current()->page(1400, 1500, 1, 2, page);
+        REQUIRE(2 == page.size());
+        REQUIRE("Meeting 13" == page[0].getTitle());
+    }
+
+    SECTION("Paging Base and Recent") {
+        // recent appointments at times base has too, and at one it doesn't, merged into the base's order
+        for (int i = 0; i < 30; i++) {
+            versions.change([i](Snapshot &next) {
+                next.add(Appointment("Recent " + to_string(i) + "|2021|10|30|" + to_string(i % 3 + 1) + ":" + (i % 2 ? "00" : "15") + " PM|15"));
+                return true;
+            });
+        }
+        shared_ptr<const Snapshot> snapshot = versions.current();
+        vector<Appointment> expected;
+        snapshot->collect(expected);
+        stable_sort(expected.begin(), expected.end(), [](const Appointment &first, const Appointment &second) {
+            return first.getTime() < second.getTime();
+        });
+        expected.erase(remove_if(expected.begin(), expected.end(), [](const Appointment &appointment) {
+            return appointment.getTime() < 1300 || appointment.getTime() >= 1600;
+        }), expected.end());
+
+        for (size_t skip = 0; skip <= expected.size(); skip += 7) {
+            vector<Appointment> page;
+            snapshot->page(1300, 1600, skip, 20, page);
+            REQUIRE(min<size_t>(20, expected.size() - skip) == page.size());
+            for (size_t i = 0; i < page.size(); i++) {
+                REQUIRE(expected[skip + i].getTitle() == page[i].getTitle());
+            }
+        }
+    }
+
+    SECTION("Paging Dates") {
+        // recent appointments on the base's date and the days around it, some folded into the base and some not
+        for (size_t i = 0; i < SNAPSHOT_RECENT_LIMIT + 40; i++) {
+            versions.change([i](Snapshot &next) {
+                next.add(Appointment("Recent " + to_string(i) + "|2021|10|" + to_string(28 + i % 3) + "|" + to_string(i % 5 + 1) + ":00 PM|15"));
+                return true;
+            });
+        }
+        shared_ptr<const Snapshot> snapshot = versions.current();
+        uint64_t fromKey = AgendaIndex::chronoKey(AgendaIndex::packDate(2021, 10, 28), 1500);
+        uint64_t toKey = AgendaIndex::chronoKey(AgendaIndex::packDate(2021, 10, 29), 1500);
+        vector<Appointment> expected;
+        snapshot->collect(expected);
+        stable_sort(expected.begin(), expected.end(), [](const Appointment &first, const Appointment &second) {
+            return AgendaIndex::chronoKey(first) < AgendaIndex::chronoKey(second);
+        });
+        expected.erase(remove_if(expected.begin(), expected.end(), [fromKey, toKey](const Appointment &appointment) {
+            return AgendaIndex::chronoKey(appointment) < fromKey || AgendaIndex::chronoKey(appointment) > toKey;
+        }), expected.end());
+
+        for (size_t skip = 0; skip <= expected.size(); skip += 37) {
+            vector<Appointment> page;
+            snapshot->pageDates(fromKey, toKey, skip, 50, page);
+            REQUIRE(min<size_t>(50, expected.size() - skip) == page.size());
+            for (size_t i = 0; i < page.size(); i++) {
+                REQUIRE(expected[skip + i].getTitle() == page[i].getTitle());
+            }
+        }
+    }
+
+    SECTION("Title Search") {
+        vector<Appointment> page;
+        versions.current()->findTitles("MEETING 99", false, 0, SIZE_MAX, page);
+        REQUIRE(11 == page.size());
+        REQUIRE("Meeting 99" == page[0].getTitle());
+
+        // the recent appointments aren't in the index, but are searched after it
+        versions.change([](Snapshot &next) {
+            next.add(Appointment("meeting 99 again|2021|10|29|8:00 AM|15"));
+            return true;
+        });
+        page.clear();
+        versions.current()->findTitles("meeting 99", true, 10, SIZE_MAX, page);
+        REQUIRE(2 == page.size());
+        REQUIRE("Meeting 999" == page[0].getTitle());
+        REQUIRE("meeting 99 again" == page[1].getTitle());
+    }
+
+    SECTION("Readers and Writers") {
+        const int WRITERS = 4, READERS = 8, ADDS = 300;  // enough to fold the recent appointments into a new base
+        versions.setCopyOnWrite(true);
+        atomic<int> writersLeft(WRITERS);
+        atomic<int> torn(0);  // versions a reader saw half-changed or older than one it saw before
+
+        vector<thread> threads;
+        for (int w = 0; w < WRITERS; w++) {
+            threads.push_back(thread([&versions, &writersLeft, w]() {
+                for (int i = 0; i < ADDS; i++) {
+                    Appointment added("Writer " + to_string(w) + "|2021|10|30|" + to_string(i % 12 + 1) + ":30 AM|15");
+                    versions.change([&added](Snapshot &next) {
+                        next.add(added);
+                        return true;
+                    });
+                }
+                writersLeft--;
+            }));
+        }
+        for (int r = 0; r < READERS; r++) {
+            threads.push_back(thread([&versions, &writersLeft, &torn]() {
+                size_t lastSize = 0;
+                do {
+                    shared_ptr<const Snapshot> snapshot = versions.current();
+                    vector<Appointment> byTime;
+                    snapshot->page(0, TIME_BUCKETS, 0, SIZE_MAX, byTime);
+                    bool sorted = byTime.size() == snapshot->size();
+                    for (size_t i = 1; sorted && i < byTime.size(); i++) {
+                        sorted = byTime[i - 1].getTime() <= byTime[i].getTime();
+                    }
+                    if (!sorted || snapshot->size() < lastSize) {
+                        torn++;
+                    }
+                    lastSize = snapshot->size();
+                } while (writersLeft > 0);
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); t++) {
+            threads[t].join();
+        }
+
+        REQUIRE(0 == torn);
+        REQUIRE(1000 + WRITERS * ADDS == versions.current()->size());
+    }
+}
+
+TEST_CASE("Testing Command Stats") {
+    enableStats(true);
+
+    SECTION("Nested Phases") {
+        {
+            PhaseTimer executing(STATS_EXECUTE);
+            PhaseTimer parsing(STATS_PARSE);
+            this_thread::sleep_for(chrono::milliseconds(20));
+            countPhase(STATS_PARSE, 3, 100);
+        }
+        REQUIRE(phaseStats(STATS_PARSE).wallSeconds >= 0.02);
+        REQUIRE(phaseStats(STATS_EXECUTE).wallSeconds < 0.02);  // the parse time isn't charged twice
+        REQUIRE(3 == phaseStats(STATS_PARSE).records);
+        REQUIRE(100 == phaseStats(STATS_PARSE).bytesRead);
+    }
+
+    SECTION("Stopping") {
+        PhaseTimer writing(STATS_WRITE);
+        writing.stop();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        writing.stop();
+        REQUIRE(phaseStats(STATS_WRITE).wallSeconds < 0.02);
+    }
+
+    SECTION("JSON Report") {
+        countPhase(STATS_OUTPUT, 2, 0, 50);
+        ostringstream report;
+        reportStats(report, "-ps");
+        REQUIRE(report.str().find("{\"command\":\"-ps\"") == 0);
+        REQUIRE(report.str().find("{\"name\":\"output\",") != string::npos);
+        REQUIRE(report.str().find("\"records\":2,\"bytes_read\":0,\"bytes_written\":50}") != string::npos);
+
+        // a batch line can hold quotes and control chars, which can't appear raw in a JSON string
+        ostringstream quoted;
+        reportStats(quoted, "-dt \"a\\b\"\tc\x01");
+        REQUIRE(quoted.str().find("{\"command\":\"-dt \\\"a\\\\b\\\"\\u0009c\\u0001\",") == 0);
+    }
+}
+
+TEST_CASE("Testing Trace Spans") {
+    startTrace();
+    {
+        TraceSpan outer("outer", "detail \"quoted\"");
+        thread worker([]() {
+            TraceSpan inner("inner");
+        });
+        worker.join();
+        outer.end();
+        outer.end();  // already recorded
+    }
+
+    string json = traceJson();
+    REQUIRE(json.find("{\"traceEvents\":[") == 0);
+    REQUIRE(json.find("{\"name\":\"inner\",\"cat\":\"agenda\",\"ph\":\"X\"") != string::npos);
+    REQUIRE(json.find("\"args\":{\"detail\":\"detail \\\"quoted\\\"\"}") != string::npos);
+    REQUIRE(json.find("\"name\":\"outer\"") == json.rfind("\"name\":\"outer\""));  // recorded once
+
+    // the spans ran on different threads, so they are on different rows
+    auto threadOf = [&json](const string &name) {
+        return stoi(json.substr(json.find("\"tid\":", json.find("\"name\":\"" + name + "\"")) + 6));
+    };
+    REQUIRE(threadOf("inner") != threadOf("outer"));
+}
+
+TEST_CASE("Testing IntervalTree Class") {
+    SECTION("Absolute Minutes") {
+        REQUIRE(0 == IntervalTree::toMinute(1970, 1, 1, 0));
+        REQUIRE(1440 + 90 == IntervalTree::toMinute(1970, 1, 2, 130));
+        REQUIRE(IntervalTree::toMinute(2020, 3, 1, 0) - IntervalTree::toMinute(2020, 2, 28, 0) == 2 * 1440);  // leap year
+        REQUIRE(IntervalTree::toMinute(2021, 3, 1, 0) - IntervalTree::toMinute(2021, 2, 28, 0) == 1440);
+    }
+
+    SECTION("Overlap Queries") {
+        vector<Interval> intervals;
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1230, 60, 0));  // 12:30-1:30
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 900, 15, 1));   // 9:00-9:15
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 2330, 60, 2));  // runs past midnight
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1000, 180, 3)); // 10:00-1:00
+        IntervalTree tree;
+        tree.build(intervals);
+
+        vector<size_t> matches = tree.overlapping(IntervalTree::toMinute(2021, 10, 29, 1000), IntervalTree::toMinute(2021, 10, 29, 1130));
+        REQUIRE(1 == matches.size());
+        REQUIRE(3 == matches[0]);
+
+        matches = tree.stabbing(IntervalTree::toMinute(2021, 10, 29, 1245));
+        REQUIRE(2 == matches.size());
+        REQUIRE(3 == matches[0]);
+        REQUIRE(0 == matches[1]);
+
+        matches = tree.stabbing(IntervalTree::toMinute(2021, 10, 30, 15));
+        REQUIRE(1 == matches.size());
+        REQUIRE(2 == matches[0]);
+
+        REQUIRE(tree.stabbing(IntervalTree::toMinute(2021, 10, 29, 915)).empty());  // intervals are half-open
+    }
+}
+
+TEST_CASE("Testing TrigramIndex Class") {
+    vector<Appointment> appointments;
+    appointments.push_back(Appointment("Fishing with Donald and Donald|2019|11|30|8:14 AM|115"));
+    appointments.push_back(Appointment("Lunch with the guys|2019|10|29|12:30 PM|60"));
+    appointments.push_back(Appointment("Appointment with DONALD|2019|12|5|8:56 PM|115"));
+    appointments.push_back(Appointment("Fish fry|2019|12|3|2:45 PM|10"));
+    appointments.push_back(Appointment("Dinner|2019|12|3|6:00 PM|60"));
+    TrigramIndex index;
+    index.build(appointments);
+
+    SECTION("Substrings") {
+        vector<uint32_t> matches = index.containing("donald");
+        REQUIRE(2 == matches.size());
+        REQUIRE(0 == matches[0]);
+        REQUIRE(2 == matches[1]);
+        REQUIRE(1 == index.containing("NALD AND DON").size());
+        REQUIRE(index.containing("donald donald").empty());  // every trigram is there, just not in this order
+        REQUIRE(index.containing("xyz").empty());
+        REQUIRE(4 == index.containing("n").size());  // too short to look up, so every title is checked
+        REQUIRE(5 == index.containing("").size());
+    }
+
+    SECTION("Prefixes") {
+        vector<uint32_t> matches = index.startingWith("FISH");
+        REQUIRE(2 == matches.size());
+        REQUIRE(0 == matches[0]);
+        REQUIRE(3 == matches[1]);
+        REQUIRE(1 == index.startingWith("d").size());
+        REQUIRE(index.startingWith("with").empty());
+        REQUIRE(5 == index.startingWith("").size());
+    }
+
+    SECTION("Checking One Title") {
+        REQUIRE(TrigramIndex::titleMatches("Fish fry", "FRY", false));  // at the very end
+        REQUIRE(TrigramIndex::titleMatches("Fish fry", "FISH FRY", true));
+        REQUIRE(false == TrigramIndex::titleMatches("Fish fry", "FRY", true));
+        REQUIRE(false == TrigramIndex::titleMatches("Fish", "FISH FRY", false));  // shorter than the text
+        REQUIRE(TrigramIndex::titleMatches("Fish", "", false));
+    }
+
+    SECTION("Matching The Scan") {
+        // every substring of every title finds the same titles as checking each one
+        for (size_t i = 0; i < appointments.size(); i++) {
+            string title(appointments[i].getTitle());
+            for (size_t first = 0; first < title.length(); first += 3) {
+                for (size_t length = 1; first + length <= title.length(); length += 2) {
+                    string folded = title.substr(first, length);
+                    Appointment::foldCase(folded.data(), folded.length());
+                    vector<uint32_t> contain, start;
+                    for (uint32_t id = 0; id < appointments.size(); id++) {
+                        if (TrigramIndex::titleMatches(appointments[id].getTitle(), folded, false)) {
+                            contain.push_back(id);
+                        }
+                        if (TrigramIndex::titleMatches(appointments[id].getTitle(), folded, true)) {
+                            start.push_back(id);
+                        }
+                    }
+                    REQUIRE(contain == index.containing(title.substr(first, length)));
+                    REQUIRE(start == index.startingWith(title.substr(first, length)));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Testing Schedule Queries") {
+    SECTION("Conflicts") {
+        vector<Interval> intervals;
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1230, 60, 0));  // 12:30-1:30
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 900, 15, 1));   // 9:00-9:15, touches the next one
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 915, 15, 2));   // 9:15-9:30
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1300, 60, 3));  // 1:00-2:00
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1345, 30, 4));  // only overlaps 1:00-2:00
+        intervals.push_back(IntervalTree::makeInterval(2021, 10, 29, 1230, 60, 5));  // duplicate of the first one
+
+        vector<vector<size_t> > groups = findConflicts(intervals);
+        REQUIRE(1 == groups.size());
+        REQUIRE(4 == groups[0].size());
+        REQUIRE(0 == groups[0][0]);
+        REQUIRE(5 == groups[0][1]);
+        REQUIRE(3 == groups[0][2]);
+        REQUIRE(4 == groups[0][3]);
+    }
+
+    SECTION("Free Slots") {
+        vector<Interval> busy;
+        busy.push_back(IntervalTree::makeInterval(2021, 10, 29, 930, 60, 0));   // 9:30-10:30
+        busy.push_back(IntervalTree::makeInterval(2021, 10, 29, 1000, 60, 1));  // 10:00-11:00, merges with the first one
+        busy.push_back(IntervalTree::makeInterval(2021, 10, 29, 1110, 20, 2));  // 11:10-11:30, leaves a gap that is too short
+        busy.push_back(IntervalTree::makeInterval(2021, 10, 29, 2300, 660, 3)); // runs into the next morning until 10:00
+
+        vector<Interval> merged = mergeIntervals(busy);
+        REQUIRE(3 == merged.size());
+        REQUIRE(IntervalTree::toMinute(2021, 10, 29, 1100) == merged[0].end);
+
+        int64_t firstDay = IntervalTree::toMinute(2021, 10, 29, 0);
+        vector<Interval> slots = findFreeSlots(busy, firstDay, firstDay + 1440, 900, 1200, 30);
+        REQUIRE(3 == slots.size());
+        REQUIRE(IntervalTree::toMinute(2021, 10, 29, 900) == slots[0].start);
+        REQUIRE(IntervalTree::toMinute(2021, 10, 29, 930) == slots[0].end);
+        REQUIRE(IntervalTree::toMinute(2021, 10, 29, 1130) == slots[1].start);
+        REQUIRE(IntervalTree::toMinute(2021, 10, 30, 1000) == slots[2].start);
+        REQUIRE(IntervalTree::toMinute(2021, 10, 30, 1200) == slots[2].end);
+
+        // a minimum of 0 reports the short gap, but not the empty span before the busy morning of the next day
+        vector<Interval> anyLength = findFreeSlots(busy, firstDay + 1440, firstDay + 1440, 0, 1200, 0);
+        REQUIRE(1 == anyLength.size());
+        REQUIRE(IntervalTree::toMinute(2021, 10, 30, 1000) == anyLength[0].start);
+        REQUIRE(4 == findFreeSlots(busy, firstDay, firstDay + 1440, 900, 1200, 0).size());
+
+        int year, month, day, time;
+        IntervalTree::fromMinute(slots[2].start, year, month, day, time);
+        REQUIRE(2021 == year);
+        REQUIRE(10 == month);
+        REQUIRE(30 == day);
+        REQUIRE(1000 == time);
+    }
+
+    SECTION("Buckets") {
+        // ISO weeks belong to the year their Thursday falls in
+        REQUIRE(202053 == bucketKey(20210103, BUCKET_WEEK));
+        REQUIRE(202101 == bucketKey(20210104, BUCKET_WEEK));
+        REQUIRE(202501 == bucketKey(20241230, BUCKET_WEEK));
+        REQUIRE(202110 == bucketKey(20211028, BUCKET_MONTH));
+
+        vector<uint32_t> dates = {20211029, 20211028, 20211029, 20211101};
+        vector<int> durations = {30, 60, 15, 45};
+        vector<Bucket> buckets = sumBuckets(dates, durations, BUCKET_DAY);
+        REQUIRE(3 == buckets.size());
+        REQUIRE(20211028 == buckets[0].key);
+        REQUIRE(2 == buckets[1].count);
+        REQUIRE(45 == buckets[1].duration);
+
+        buckets = sumBuckets(dates, durations, BUCKET_MONTH);
+        REQUIRE(2 == buckets.size());
+        REQUIRE(3 == buckets[0].count);
+        REQUIRE(105 == buckets[0].duration);
+    }
+}
@@ -0,0 +1,95 @@
+#include "agenda_alloc_stats.h"
+
+#ifdef AGENDA_ALLOC_STATS
+
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+using namespace std;
+
+const char *PHASE_NAMES[ALLOC_PHASES] = {"other", "parse", "format", "query", "write"};
+
+static atomic<unsigned long long> allocationCounts[ALLOC_PHASES];
+static atomic<unsigned long long> allocationBytes[ALLOC_PHASES];
+static thread_local int currentPhase = ALLOC_OTHER;  // constant-initialized, so reading it never allocates
+
+///counting
+
+void *operator new(size_t size) {
+    allocationCounts[currentPhase].fetch_add(1, memory_order_relaxed);
+    allocationBytes[currentPhase].fetch_add(size, memory_order_relaxed);
+    void *block = malloc(size == 0 ? 1 : size);
+    if (block == NULL) {
+        throw bad_alloc();
+    }
+
+    return block;
+}
+
+void operator delete(void *block) noexcept {
+    free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    free(block);
+}
+
+// memory resources allocate through the aligned forms, titles of appointments included
+void *operator new(size_t size, align_val_t alignment) {
+    allocationCounts[currentPhase].fetch_add(1, memory_order_relaxed);
+    allocationBytes[currentPhase].fetch_add(size, memory_order_relaxed);
+    void *block = NULL;
+    if (posix_memalign(&block, max(static_cast<size_t>(alignment), sizeof(void *)), size == 0 ? 1 : size) != 0) {
+        throw bad_alloc();
+    }
+
+    return block;
+}
+
+void operator delete(void *block, align_val_t) noexcept {
+    free(block);
+}
+
+void operator delete(void *block, size_t, align_val_t) noexcept {
+    free(block);
+}
+
+///constructors
+
+AllocationScope::AllocationScope(int phase) {
+    previous = currentPhase;
+    currentPhase = phase;
+}
+
+AllocationScope::~AllocationScope() {
+    currentPhase = previous;
+}
+
+
+///reporting
+
+void reportAllocations(ostream &out, const string &command) {
+    size_t first = command.find_first_not_of(" \t");
+    if (first == string::npos || command[first] == '#') {
+        return;
+    }
+
+    // take every count before printing, so the report's own allocations go to the next one
+    unsigned long long counts[ALLOC_PHASES], bytes[ALLOC_PHASES];
+    for (int i = 0; i < ALLOC_PHASES; i++) {
+        counts[i] = allocationCounts[i].exchange(0);
+        bytes[i] = allocationBytes[i].exchange(0);
+    }
+
+    string label = command.substr(first, command.find_first_of(" \t", first) - first);
+    for (int i = 0; i < ALLOC_PHASES; i++) {
+        if (counts[i] > 0) {
+            out << "alloc command=" << label << " phase=" << PHASE_NAMES[i] << " allocations=" << counts[i] << " bytes=" << bytes[i] << endl;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ *   @file: agenda_alloc_stats.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Counts the allocations each phase of a command makes, in builds compiled with AGENDA_ALLOC_STATS.
+ * 
+ * Code marks the phase it is in with an AllocationScope, and every operator new made on that thread
+ * counts toward the phase until the scope ends. Without AGENDA_ALLOC_STATS the scopes and reports
+ * compile to nothing and operator new isn't replaced.
+ */
+
+#ifndef AGENDA_ALLOC_STATS_H
+#define AGENDA_ALLOC_STATS_H
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+const int ALLOC_OTHER = 0;   // anything outside a command, like reading the log at startup
+const int ALLOC_PARSE = 1;   // turning lines into appointments
+const int ALLOC_FORMAT = 2;  // turning appointments into lines
+const int ALLOC_QUERY = 3;   // the rest of a command: loading, sorting, searching
+const int ALLOC_WRITE = 4;   // saving the agenda file and its sidecars
+const int ALLOC_PHASES = 5;
+
+#ifdef AGENDA_ALLOC_STATS
+
+class AllocationScope {
+    public:
+        /**
+         * @brief Construct a new AllocationScope object, counting this thread's allocations toward a phase.
+         * 
+         * @param phase one of the ALLOC_ phases
+         */
+        AllocationScope(int phase);
+
+        /**
+         * @brief Destroy the AllocationScope object, going back to the phase before it.
+         */
+        ~AllocationScope();
+    private:
+        int previous;  // the thread's phase when the scope started
+
+        AllocationScope(const AllocationScope &);
+        AllocationScope &operator =(const AllocationScope &);
+};
+
+/**
+ * Function: reportAllocations
+ * @brief Prints the allocations and bytes counted in each phase since the last report, one line per phase,
+ * and starts counting from zero again.
+ * 
+ * Blank lines and lines starting with # are counted toward the next report instead.
+ * 
+ * @param out stream to print to
+ * @param command the command line the counts belong to, labelled by its first word
+ */
+void reportAllocations(ostream &out, const string &command);
+
+#else
+
+class AllocationScope {
+    public:
+        AllocationScope(int) {}
+};
+
+inline void reportAllocations(ostream &, const string &) {}
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "agenda_arena.h"
+using namespace std;
+
+///constructors
+
+AgendaArena::AgendaArena() : blocks(0), bytes(0) {
+}
+
+AgendaArena::~AgendaArena() {
+    parts.clear();  // the parts give their blocks back through the arena, so they go while it is still whole
+}
+
+
+///allocating
+
+pmr::memory_resource *AgendaArena::addPart(size_t expected) {
+    pmr::memory_resource *upstream = this;  // the parts take their blocks from the arena, which counts them
+    parts.push_back(make_unique<pmr::monotonic_buffer_resource>(max<size_t>(expected, 64), upstream));
+
+    return parts.back().get();
+}
+
+size_t AgendaArena::blockCount() const {
+    return blocks;
+}
+
+size_t AgendaArena::blockBytes() const {
+    return bytes;
+}
+
+void *AgendaArena::do_allocate(size_t size, size_t alignment) {
+    blocks++;
+    bytes += size;
+
+    return pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void AgendaArena::do_deallocate(void *block, size_t size, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(block, size, alignment);
+}
+
+bool AgendaArena::do_is_equal(const pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
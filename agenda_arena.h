@@ -0,0 +1,70 @@
+/**
+ *   @file: agenda_arena.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Memory for the titles of a loaded agenda, taken in a few large blocks and given back all at once, for --arena.
+ * 
+ * Each part of the arena is a monotonic buffer that one thread allocates from without locking. Freeing a title
+ * from a part does nothing; the blocks are only given back when the arena is destroyed, so every appointment
+ * whose title came from the arena must be gone by then.
+ */
+
+#ifndef AGENDA_ARENA_H
+#define AGENDA_ARENA_H
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <atomic>
+using namespace std;
+
+class AgendaArena : private pmr::memory_resource {
+    public:
+        /**
+         * @brief Construct a new AgendaArena object with no parts.
+         */
+        AgendaArena();
+
+        /**
+         * @brief Destroy the AgendaArena object, giving back every block of every part.
+         */
+        ~AgendaArena();
+
+        /**
+         * Function: addPart
+         * @brief Adds a part for one thread to allocate from. Parts must be added by one thread at a time.
+         * 
+         * @param expected how many bytes the part is expected to hold, which is the size of its first block
+         * @return the part, valid until the arena is destroyed
+         */
+        pmr::memory_resource *addPart(size_t expected);
+
+        /**
+         * Function: blockCount
+         * @brief Gets the number of blocks the parts took so far.
+         * 
+         * @return number of blocks
+         */
+        size_t blockCount() const;
+
+        /**
+         * Function: blockBytes
+         * @brief Gets the size of all the blocks the parts took so far.
+         * 
+         * @return number of bytes
+         */
+        size_t blockBytes() const;
+    private:
+        vector<unique_ptr<pmr::monotonic_buffer_resource> > parts;  // one per thread that allocated from the arena
+        atomic<size_t> blocks;  // blocks taken by the parts, which can grow on several threads at once
+        atomic<size_t> bytes;   // size of those blocks
+
+        void *do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void *block, size_t size, size_t alignment) override;
+        bool do_is_equal(const pmr::memory_resource &other) const noexcept override;
+
+        AgendaArena(const AgendaArena &);
+        AgendaArena &operator =(const AgendaArena &);
+};
+
+#endif
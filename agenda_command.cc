@@ -0,0 +1,59 @@
+#include <string>
+#include <vector>
+#include <cctype>
+#include "agenda_command.h"
+using namespace std;
+
+vector<string> splitCommand(const string &line) {
+    vector<string> args;
+    string arg;
+    bool inArg = false;  // whether arg holds an argument, possibly an empty quoted one
+    char quote = 0;      // the quote that opened the current quoted span, if any
+
+    for (size_t i = 0; i < line.length(); i++) {
+        char c = line[i];
+        if (quote != 0) {
+            if (c == quote) {
+                quote = 0;
+            }
+            else {
+                arg += c;
+            }
+        }
+        else if (c == '"' || c == '\'') {
+            quote = c;
+            inArg = true;
+        }
+        else if (isspace(static_cast<unsigned char>(c))) {
+            if (inArg) {
+                args.push_back(arg);
+                arg.clear();
+                inArg = false;
+            }
+        }
+        else {
+            arg += c;
+            inArg = true;
+        }
+    }
+    if (inArg) {
+        args.push_back(arg);
+    }
+
+    return args;
+}
+
+string quoteArgument(const string &arg) {
+    // double quotes can't appear inside a double-quoted span, so they get single-quoted spans of their own
+    string quoted = "\"";
+    for (size_t i = 0; i < arg.length(); i++) {
+        if (arg[i] == '"') {
+            quoted += "\"'\"'\"";
+        }
+        else {
+            quoted += arg[i];
+        }
+    }
+
+    return quoted + "\"";
+}
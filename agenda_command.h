@@ -0,0 +1,33 @@
+/**
+ *   @file: agenda_command.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Splits the lines of batch scripts and client requests into arguments, and quotes arguments to fit in them.
+ */
+
+#ifndef AGENDA_COMMAND_H
+#define AGENDA_COMMAND_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Function: splitCommand
+ * @brief Splits a line of a batch script into arguments at whitespace, keeping quoted spans together.
+ * 
+ * @param line the line
+ * @return the arguments, without their quotes
+ */
+vector<string> splitCommand(const string &line);
+
+/**
+ * Function: quoteArgument
+ * @brief Quotes an argument so splitCommand reads it back unchanged.
+ * 
+ * @param arg the argument
+ * @return the quoted argument
+ */
+string quoteArgument(const string &arg);
+
+#endif
@@ -0,0 +1,70 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cctype>
+#include <unordered_set>
+#include "agenda_dedupe.h"
+using namespace std;
+
+string normalizeTitle(string_view title) {
+    string normalized;
+    normalized.reserve(title.length());
+
+    bool pendingSpace = false;  // whether a run of whitespace was skipped since the last char
+    for (size_t i = 0; i < title.length(); i++) {
+        if (isspace(static_cast<unsigned char>(title[i]))) {
+            pendingSpace = !normalized.empty();
+        }
+        else {
+            if (pendingSpace) {
+                normalized += ' ';
+                pendingSpace = false;
+            }
+            normalized += static_cast<char>(toupper(static_cast<unsigned char>(title[i])));
+        }
+    }
+
+    return normalized;
+}
+
+size_t removeDuplicates(vector<Appointment> &appointments, bool normalizeTitles) {
+    // with normalized titles, the comparisons run on a copy whose titles were normalized
+    vector<Appointment> normalized;
+    if (normalizeTitles) {
+        normalized = appointments;
+        for (size_t i = 0; i < normalized.size(); i++) {
+            normalized[i].setTitle(normalizeTitle(normalized[i].getTitle()));
+        }
+    }
+    vector<Appointment> &keys = normalizeTitles ? normalized : appointments;
+
+    // the set holds positions of kept appointments, hashed and compared through the keys
+    hash<Appointment> hasher;
+    auto hashKey = [&keys, &hasher](size_t position) {
+        return hasher(keys[position]);
+    };
+    auto sameKey = [&keys](size_t first, size_t second) {
+        return keys[first] == keys[second];
+    };
+    unordered_set<size_t, decltype(hashKey), decltype(sameKey)> kept(appointments.size(), hashKey, sameKey);
+
+    // compact in place; an appointment moves down to the next free position before being checked,
+    // so the positions already in the set are never overwritten
+    size_t keptCount = 0;
+    for (size_t i = 0; i < appointments.size(); i++) {
+        if (i != keptCount) {
+            appointments[keptCount] = move(appointments[i]);
+            if (normalizeTitles) {
+                normalized[keptCount] = move(normalized[i]);
+            }
+        }
+        if (kept.insert(keptCount).second) {
+            keptCount++;
+        }
+    }
+
+    size_t removed = appointments.size() - keptCount;
+    appointments.resize(keptCount);
+
+    return removed;
+}
@@ -0,0 +1,36 @@
+/**
+ *   @file: agenda_dedupe.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Removes duplicate appointments from an agenda with a single hashed pass.
+ */
+
+#ifndef AGENDA_DEDUPE_H
+#define AGENDA_DEDUPE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "appointment.h"
+using namespace std;
+
+/**
+ * Function: normalizeTitle
+ * @brief Uppercases a title and collapses its whitespace, so titles that only differ in case or spacing compare equal.
+ * 
+ * @param title the title
+ * @return the title without leading or trailing whitespace, its inner runs of whitespace replaced by single spaces
+ */
+string normalizeTitle(string_view title);
+
+/**
+ * Function: removeDuplicates
+ * @brief Removes every appointment that equals an earlier one, in O(n) expected time.
+ * 
+ * @param appointments the appointments, left in their original order with the first copy of each kept
+ * @param normalizeTitles whether titles are compared after normalizeTitle instead of exactly
+ * @return the number of appointments removed
+ */
+size_t removeDuplicates(vector<Appointment> &appointments, bool normalizeTitles);
+
+#endif
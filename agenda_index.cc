@@ -0,0 +1,473 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "agenda_index.h"
+#include "agenda_trace.h"
+using namespace std;
+
+const char INDEX_MAGIC[4] = {'A', 'G', 'X', '1'};
+const uint32_t INDEX_VERSION = 3;  // 3 hashes titles folded to uppercase
+const size_t CHECKSUM_SAMPLE = 4096;  // bytes hashed from each end of the agenda file
+
+// fixed-size header at the start of every index file
+struct IndexHeader {
+    char magic[4];        // INDEX_MAGIC
+    uint32_t version;     // INDEX_VERSION
+    uint64_t fileSize;    // size of the agenda file the index was built from
+    int64_t fileMtime;    // modification time of that agenda file
+    uint64_t checksum;    // sampled checksum of that agenda file
+    uint64_t count;       // number of records
+    uint32_t firstDate;   // earliest packed date
+    uint32_t lastDate;    // latest packed date
+};
+
+/**
+ * Function: stampAgenda
+ * @brief Fills in the size, mtime and checksum of an agenda file.
+ * 
+ * The checksum covers the first and last CHECKSUM_SAMPLE bytes so it stays cheap on huge agendas;
+ * together with the size and mtime it catches edits made behind the program's back.
+ * 
+ * @return false if the agenda file doesn't exist
+ */
+static bool stampAgenda(const string &agendaPath, IndexHeader &header) {
+    if (!AgendaIndex::fileStamp(agendaPath, header.fileSize, header.fileMtime)) {
+        return false;
+    }
+
+    ifstream agendaFile(agendaPath, ios::binary);
+    if (agendaFile.fail()) {
+        return false;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;  // 64-bit FNV-1a
+    char buffer[CHECKSUM_SAMPLE];
+    for (int pass = 0; pass < 2; pass++) {
+        uint64_t start = 0;
+        if (pass == 1) {
+            if (header.fileSize <= CHECKSUM_SAMPLE) {
+                break;  // the first pass already covered the whole file
+            }
+            start = header.fileSize - CHECKSUM_SAMPLE;
+        }
+        agendaFile.seekg(start);
+        agendaFile.read(buffer, CHECKSUM_SAMPLE);
+        streamsize bytesRead = agendaFile.gcount();
+        agendaFile.clear();
+        for (streamsize i = 0; i < bytesRead; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+    header.checksum = hash;
+
+    return true;
+}
+
+/**
+ * Function: readFreshHeader
+ * @brief Opens an index file and reads its header if it matches the agenda file.
+ * 
+ * @return true if the header was read and the index is fresh
+ */
+static bool readFreshHeader(const string &agendaPath, ifstream &indexFile, IndexHeader &header) {
+    indexFile.open(AgendaIndex::fileName(agendaPath), ios::binary);
+    if (indexFile.fail()) {
+        return false;
+    }
+    indexFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!indexFile || memcmp(header.magic, INDEX_MAGIC, 4) != 0 || header.version != INDEX_VERSION) {
+        return false;
+    }
+
+    IndexHeader current;
+    if (!stampAgenda(agendaPath, current)) {
+        return false;
+    }
+
+    return current.fileSize == header.fileSize && current.fileMtime == header.fileMtime && current.checksum == header.checksum;
+}
+
+/**
+ * Function: byDateStart
+ * @brief Gets where the date ordering starts in an index file.
+ * 
+ * The file holds the header, the bucket table, the time ordering, the date ordering and then the entries.
+ * 
+ * @return byte offset of the date ordering
+ */
+static uint64_t byDateStart(const IndexHeader &header) {
+    return sizeof(header) + (TIME_BUCKETS + 1 + header.count) * sizeof(uint32_t);
+}
+
+/**
+ * Function: entriesStart
+ * @brief Gets where the entries start in an index file.
+ * 
+ * @return byte offset of the first entry
+ */
+static uint64_t entriesStart(const IndexHeader &header) {
+    return byDateStart(header) + header.count * sizeof(uint32_t);
+}
+
+/**
+ * Function: countBuckets
+ * @brief Counts the records in each time bucket.
+ * 
+ * @return the position of the first record of each bucket in the time ordering, plus the total at the end
+ */
+static vector<uint32_t> countBuckets(const vector<IndexEntry> &entries) {
+    vector<uint32_t> bucketStart(TIME_BUCKETS + 1, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        bucketStart[entries[i].time + 1]++;
+    }
+    for (int t = 0; t < TIME_BUCKETS; t++) {
+        bucketStart[t + 1] += bucketStart[t];
+    }
+
+    return bucketStart;
+}
+
+
+///constructors
+
+AgendaIndex::AgendaIndex() {
+    firstDate = 0;
+    lastDate = 0;
+}
+
+
+///modifiers
+
+void AgendaIndex::clear() {
+    entries.clear();
+    firstDate = 0;
+    lastDate = 0;
+}
+
+void AgendaIndex::addRecord(const Appointment &appointment, uint64_t offset) {
+    IndexEntry entry;
+    entry.offset = offset;
+    entry.date = packDate(appointment.getYear(), appointment.getMonth(), appointment.getDay());
+    entry.titleHash = appointment.getTitleKey();  // the same as hashTitle, without hashing again
+    entry.time = appointment.getTime();
+    entry.duration = appointment.getDuration();
+
+    if (entries.empty() || entry.date < firstDate) {
+        firstDate = entry.date;
+    }
+    if (entries.empty() || entry.date > lastDate) {
+        lastDate = entry.date;
+    }
+    entries.push_back(entry);
+}
+
+
+///getters
+
+size_t AgendaIndex::size() const {
+    return entries.size();
+}
+
+const IndexEntry &AgendaIndex::at(size_t record) const {
+    return entries[record];
+}
+
+vector<uint32_t> AgendaIndex::byTime() const {
+    // counting sort keeps ties in file order
+    vector<uint32_t> bucketStart = countBuckets(entries);
+    vector<uint32_t> order(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        order[bucketStart[entries[i].time]++] = i;
+    }
+
+    return order;
+}
+
+vector<uint32_t> AgendaIndex::byDate() const {
+    vector<uint32_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [this](uint32_t first, uint32_t second) {
+        return chronoKey(entries[first].date, entries[first].time) < chronoKey(entries[second].date, entries[second].time);
+    });
+
+    return order;
+}
+
+vector<uint32_t> AgendaIndex::findTitle(const string &title) const {
+    uint32_t hash = hashTitle(title);
+    vector<uint32_t> records;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].titleHash == hash) {
+            records.push_back(i);
+        }
+    }
+
+    return records;
+}
+
+vector<uint32_t> AgendaIndex::findTime(int time) const {
+    vector<uint32_t> records;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].time == time) {
+            records.push_back(i);
+        }
+    }
+
+    return records;
+}
+
+uint32_t AgendaIndex::getFirstDate() const {
+    return firstDate;
+}
+
+uint32_t AgendaIndex::getLastDate() const {
+    return lastDate;
+}
+
+
+///file access
+
+bool AgendaIndex::load(const string &agendaPath) {
+    ifstream indexFile;
+    IndexHeader header;
+    if (!readFreshHeader(agendaPath, indexFile, header)) {
+        return false;
+    }
+
+    // skip the bucket table and both orderings, they can all be rebuilt from the entries
+    indexFile.seekg(entriesStart(header));
+    vector<IndexEntry> loaded(header.count);
+    indexFile.read(reinterpret_cast<char *>(loaded.data()), header.count * sizeof(IndexEntry));
+    if (!indexFile) {
+        return false;
+    }
+
+    entries.swap(loaded);
+    firstDate = header.firstDate;
+    lastDate = header.lastDate;
+
+    return true;
+}
+
+bool AgendaIndex::save(const string &agendaPath) const {
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, 4);
+    header.version = INDEX_VERSION;
+    if (!stampAgenda(agendaPath, header)) {
+        return false;
+    }
+    header.count = entries.size();
+    header.firstDate = firstDate;
+    header.lastDate = lastDate;
+
+    TraceSpan ordering("order index");
+    vector<uint32_t> order = byTime();
+    vector<uint32_t> dateOrder = byDate();
+    vector<uint32_t> bucketStart = countBuckets(entries);
+    ordering.end();
+
+    // readers holding the shared lock may rebuild the index at the same time, so each writes a file of its own and swaps it in
+    TraceSpan writing("write index");
+    string tempName = fileName(agendaPath) + ".tmp" + to_string(getpid());
+    ofstream indexFile(tempName, ios::binary | ios::trunc);
+    if (indexFile.fail()) {
+        return false;
+    }
+    indexFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    indexFile.write(reinterpret_cast<const char *>(bucketStart.data()), bucketStart.size() * sizeof(uint32_t));
+    indexFile.write(reinterpret_cast<const char *>(order.data()), order.size() * sizeof(uint32_t));
+    indexFile.write(reinterpret_cast<const char *>(dateOrder.data()), dateOrder.size() * sizeof(uint32_t));
+    indexFile.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(IndexEntry));
+    indexFile.close();
+    if (indexFile.fail()) {
+        remove(tempName.c_str());
+        return false;
+    }
+
+    return rename(tempName.c_str(), fileName(agendaPath).c_str()) == 0;
+}
+
+bool AgendaIndex::lookupTimes(const string &agendaPath, int fromTime, int toTime, size_t skip, size_t limit, vector<uint32_t> &records, vector<uint64_t> &offsets) {
+    ifstream indexFile;
+    IndexHeader header;
+    if (!readFreshHeader(agendaPath, indexFile, header)) {
+        return false;
+    }
+
+    records.clear();
+    offsets.clear();
+    fromTime = max(fromTime, 0);
+    toTime = min(toTime, TIME_BUCKETS);
+    if (fromTime >= toTime) {
+        return true;  // no record can start in an empty or invalid range
+    }
+
+    // the buckets are contiguous in the time ordering, so the range is one slice of it
+    uint32_t first, last;
+    indexFile.seekg(sizeof(header) + fromTime * sizeof(uint32_t));
+    indexFile.read(reinterpret_cast<char *>(&first), sizeof(first));
+    indexFile.seekg(sizeof(header) + toTime * sizeof(uint32_t));
+    indexFile.read(reinterpret_cast<char *>(&last), sizeof(last));
+    if (skip >= last - first) {
+        return static_cast<bool>(indexFile);
+    }
+    first += skip;
+    last = first + min<uint64_t>(limit, last - first);
+
+    // read only the requested part of the slice
+    records.resize(last - first);
+    indexFile.seekg(sizeof(header) + (TIME_BUCKETS + 1 + first) * sizeof(uint32_t));
+    indexFile.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(uint32_t));
+
+    for (size_t i = 0; i < records.size(); i++) {
+        IndexEntry entry;
+        indexFile.seekg(entriesStart(header) + records[i] * sizeof(IndexEntry));  // entries are fixed size, so any record is one seek away
+        indexFile.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+        offsets.push_back(entry.offset);
+    }
+
+    return static_cast<bool>(indexFile);
+}
+
+bool AgendaIndex::lookupDates(const string &agendaPath, uint64_t fromKey, uint64_t toKey, size_t skip, size_t limit, vector<uint32_t> &records, vector<uint64_t> &offsets) {
+    ifstream indexFile;
+    IndexHeader header;
+    if (!readFreshHeader(agendaPath, indexFile, header)) {
+        return false;
+    }
+
+    records.clear();
+    offsets.clear();
+
+    // reads the key of the record at a position of the date ordering
+    auto keyAt = [&](uint64_t position) {
+        uint32_t record;
+        IndexEntry entry;
+        indexFile.seekg(byDateStart(header) + position * sizeof(uint32_t));
+        indexFile.read(reinterpret_cast<char *>(&record), sizeof(record));
+        indexFile.seekg(entriesStart(header) + record * sizeof(IndexEntry));
+        indexFile.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+        return chronoKey(entry.date, entry.time);
+    };
+
+    // binary search for the first key in the range and the first key after it
+    uint64_t low = 0, high = header.count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (keyAt(middle) < fromKey) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    uint64_t first = low;
+    high = header.count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (keyAt(middle) <= toKey) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    uint64_t last = low;
+
+    if (skip >= last - first) {
+        return static_cast<bool>(indexFile);
+    }
+    first += skip;
+    last = first + min<uint64_t>(limit, last - first);
+
+    // read only the requested part of the range
+    records.resize(last - first);
+    indexFile.seekg(byDateStart(header) + first * sizeof(uint32_t));
+    indexFile.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(uint32_t));
+    for (size_t i = 0; i < records.size(); i++) {
+        IndexEntry entry;
+        indexFile.seekg(entriesStart(header) + records[i] * sizeof(IndexEntry));
+        indexFile.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+        offsets.push_back(entry.offset);
+    }
+
+    return static_cast<bool>(indexFile);
+}
+
+bool AgendaIndex::lookupRecord(const string &agendaPath, size_t record, uint64_t &offset) {
+    ifstream indexFile;
+    IndexHeader header;
+    if (!readFreshHeader(agendaPath, indexFile, header) || record >= header.count) {
+        return false;
+    }
+
+    IndexEntry entry;
+    indexFile.seekg(entriesStart(header) + record * sizeof(IndexEntry));
+    indexFile.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+    offset = entry.offset;
+
+    return static_cast<bool>(indexFile);
+}
+
+bool AgendaIndex::isFresh(const string &agendaPath) {
+    ifstream indexFile;
+    IndexHeader header;
+    return readFreshHeader(agendaPath, indexFile, header);
+}
+
+
+///helpers
+
+bool AgendaIndex::fileStamp(const string &path, uint64_t &size, int64_t &mtime) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    size = info.st_size;
+#ifdef __linux__
+    mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    mtime = static_cast<int64_t>(info.st_mtime) * 1000000000;
+#endif
+
+    return true;
+}
+
+string AgendaIndex::snapshotTag(const string &agendaPath) {
+    uint64_t size;
+    int64_t mtime;
+    if (!fileStamp(agendaPath, size, mtime)) {
+        return "";
+    }
+
+    return "S|" + to_string(size) + "|" + to_string(mtime);
+}
+
+string AgendaIndex::fileName(const string &agendaPath) {
+    return agendaPath + ".idx";
+}
+
+uint32_t AgendaIndex::hashTitle(string_view title) {
+    return Appointment::foldedHash(title);
+}
+
+uint32_t AgendaIndex::packDate(int year, int month, int day) {
+    return year * 10000 + month * 100 + day;
+}
+
+uint64_t AgendaIndex::chronoKey(uint32_t date, int time) {
+    return static_cast<uint64_t>(date) * 10000 + time;
+}
+
+uint64_t AgendaIndex::chronoKey(const Appointment &appointment) {
+    return chronoKey(packDate(appointment.getYear(), appointment.getMonth(), appointment.getDay()), appointment.getTime());
+}
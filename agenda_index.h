@@ -0,0 +1,256 @@
+/**
+ *   @file: agenda_index.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Sidecar index file kept next to the agenda file.
+ */
+
+#ifndef AGENDA_INDEX_H
+#define AGENDA_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "appointment.h"
+using namespace std;
+
+const int TIME_BUCKETS = 2400;  // one bucket per military time value, most of them unused
+
+struct IndexEntry {
+    uint64_t offset;     // byte offset of the record's line in the agenda file
+    uint32_t date;       // packed date of the record (YYYYMMDD)
+    uint32_t titleHash;  // hash of the record's title folded to uppercase
+    int32_t time;        // starting time of the record in military format
+    int32_t duration;    // duration of the record
+};
+
+class AgendaIndex {
+    public:
+        /**
+         * @brief Construct a new empty AgendaIndex object.
+         */
+        AgendaIndex();
+
+        /**
+         * Function: clear
+         * @brief Removes every record from the index.
+         */
+        void clear();
+
+        /**
+         * Function: addRecord
+         * @brief Adds a record to the end of the index.
+         * 
+         * @param appointment the appointment stored in the record
+         * @param offset the byte offset of the record's line in the agenda file
+         */
+        void addRecord(const Appointment &appointment, uint64_t offset);
+
+        /**
+         * Function: size
+         * @brief Gets the number of records in the index.
+         * 
+         * @return number of records
+         */
+        size_t size() const;
+
+        /**
+         * Function: at
+         * @brief Gets the entry of a record.
+         * 
+         * @param record the record number
+         * @return the entry of the record
+         */
+        const IndexEntry &at(size_t record) const;
+
+        /**
+         * Function: byTime
+         * @brief Gets every record number ordered by starting time, ties kept in file order.
+         * 
+         * @return record numbers sorted by time
+         */
+        vector<uint32_t> byTime() const;
+
+        /**
+         * Function: byDate
+         * @brief Gets every record number ordered by starting date and time, ties kept in file order.
+         * 
+         * @return record numbers sorted chronologically
+         */
+        vector<uint32_t> byDate() const;
+
+        /**
+         * Function: findTitle
+         * @brief Finds the records whose title hash matches a title in any case; hash collisions are possible, so callers must check the titles.
+         * 
+         * @param title the title
+         * @return candidate record numbers in file order
+         */
+        vector<uint32_t> findTitle(const string &title) const;
+
+        /**
+         * Function: findTime
+         * @brief Finds the records starting at a time.
+         * 
+         * @param time the starting time in military format
+         * @return record numbers in file order
+         */
+        vector<uint32_t> findTime(int time) const;
+
+        /**
+         * Function: getFirstDate
+         * @brief Gets the earliest packed date in the index.
+         * 
+         * @return earliest date (YYYYMMDD), 0 if the index is empty
+         */
+        uint32_t getFirstDate() const;
+
+        /**
+         * Function: getLastDate
+         * @brief Gets the latest packed date in the index.
+         * 
+         * @return latest date (YYYYMMDD), 0 if the index is empty
+         */
+        uint32_t getLastDate() const;
+
+        /**
+         * Function: load
+         * @brief Reads the index file of an agenda if it is still in sync with the agenda.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return true if a fresh index was read
+         */
+        bool load(const string &agendaPath);
+
+        /**
+         * Function: save
+         * @brief Writes the index file of an agenda, stamped with the agenda's current size, mtime and checksum.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return true if the index file was written
+         */
+        bool save(const string &agendaPath) const;
+
+        /**
+         * Function: lookupTimes
+         * @brief Finds the records starting in a time range straight from the index file, without loading it.
+         * 
+         * @param agendaPath path of the agenda file
+         * @param fromTime the first starting time in military format
+         * @param toTime the starting time after the range in military format
+         * @param skip the number of matching records to skip
+         * @param limit the maximum number of records to return
+         * @param records receives the matching record numbers, sorted by time with ties in file order
+         * @param offsets receives the file offsets of the matching records, in the same order
+         * @return false if the index file is missing or stale
+         */
+        static bool lookupTimes(const string &agendaPath, int fromTime, int toTime, size_t skip, size_t limit, vector<uint32_t> &records, vector<uint64_t> &offsets);
+
+        /**
+         * Function: lookupDates
+         * @brief Finds the records starting in a span of dates and times straight from the index file,
+         * using binary search over the date ordering.
+         * 
+         * @param agendaPath path of the agenda file
+         * @param fromKey the first starting date and time, as returned by chronoKey
+         * @param toKey the last starting date and time, as returned by chronoKey
+         * @param skip the number of matching records to skip
+         * @param limit the maximum number of records to return
+         * @param records receives the matching record numbers in chronological order
+         * @param offsets receives the file offsets of the matching records, in the same order
+         * @return false if the index file is missing or stale
+         */
+        static bool lookupDates(const string &agendaPath, uint64_t fromKey, uint64_t toKey, size_t skip, size_t limit, vector<uint32_t> &records, vector<uint64_t> &offsets);
+
+        /**
+         * Function: lookupRecord
+         * @brief Finds the line of a record straight from the index file, without loading it.
+         * 
+         * @param agendaPath path of the agenda file
+         * @param record the record number
+         * @param offset receives the file offset of the record's line
+         * @return false if the index file is missing or stale, or the record doesn't exist
+         */
+        static bool lookupRecord(const string &agendaPath, size_t record, uint64_t &offset);
+
+        /**
+         * Function: isFresh
+         * @brief Checks if the index file of an agenda is still in sync with the agenda.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return true if the index file can be reused
+         */
+        static bool isFresh(const string &agendaPath);
+
+        /**
+         * Function: fileStamp
+         * @brief Gets the size and modification time of a file.
+         * 
+         * @param path path of the file
+         * @param size receives the size of the file in bytes
+         * @param mtime receives the modification time of the file in nanoseconds
+         * @return false if the file doesn't exist
+         */
+        static bool fileStamp(const string &path, uint64_t &size, int64_t &mtime);
+
+        /**
+         * Function: snapshotTag
+         * @brief Builds a line that ties a sidecar file to one version of an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return the tag line, or an empty string if the agenda file doesn't exist
+         */
+        static string snapshotTag(const string &agendaPath);
+
+        /**
+         * Function: fileName
+         * @brief Gets the path of the index file kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return path of the index file
+         */
+        static string fileName(const string &agendaPath);
+
+        /**
+         * Function: hashTitle
+         * @brief Hashes a title the same way the index does, so titles that only differ in case hash the same.
+         * 
+         * @param title the title
+         * @return 32-bit FNV-1a hash of the title folded to uppercase
+         */
+        static uint32_t hashTitle(string_view title);
+
+        /**
+         * Function: packDate
+         * @brief Packs a date into a single sortable number.
+         * 
+         * @return the date as YYYYMMDD
+         */
+        static uint32_t packDate(int year, int month, int day);
+
+        /**
+         * Function: chronoKey
+         * @brief Combines a packed date and a military time into a single sortable number.
+         * 
+         * @param date the packed date
+         * @param time the time in military format
+         * @return the date and time as YYYYMMDDHHMM
+         */
+        static uint64_t chronoKey(uint32_t date, int time);
+
+        /**
+         * Function: chronoKey
+         * @brief Gets the starting date and time of an appointment as a single sortable number.
+         * 
+         * @param appointment the appointment
+         * @return the date and time as YYYYMMDDHHMM
+         */
+        static uint64_t chronoKey(const Appointment &appointment);
+    private:
+        vector<IndexEntry> entries;  // one entry per record, in file order
+        uint32_t firstDate;          // earliest packed date in the index
+        uint32_t lastDate;           // latest packed date in the index
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "agenda_load.h"
+#include "agenda_alloc_stats.h"
+#include "agenda_stats.h"
+#include "agenda_trace.h"
+using namespace std;
+
+///loading
+
+size_t parseAgenda(string_view contents, const Tombstones &tombstones, AgendaArena *arena, vector<Appointment> &appointments, AgendaIndex &index) {
+    PhaseTimer parsing(STATS_PARSE);
+    vector<size_t> lineStarts;  // byte offset of every line
+
+    // find where every line starts, so the lines can be split into independent ranges
+    if (!contents.empty()) {
+        lineStarts.push_back(0);
+    }
+    for (size_t i = contents.find('\n'); i != string_view::npos; i = contents.find('\n', i + 1)) {
+        if (i + 1 < contents.size()) {
+            lineStarts.push_back(i + 1);
+        }
+    }
+    lineStarts.push_back(contents.size() + 1);  // where the line after the last one would start
+
+    // parse each range of lines on its own thread, building its appointments in place in a vector of its own;
+    // the first range is parsed on the calling thread, so a small agenda starts no thread at all
+    size_t lineCount = lineStarts.size() - 1;
+    vector<char> blank(lineCount);  // whether each line has only whitespace
+    size_t threadCount = min<size_t>(max(thread::hardware_concurrency(), 1U), lineCount / LINES_PER_THREAD + 1);
+    vector<vector<Appointment> > parsed(threadCount);  // appointments of each range's lines
+    auto parseRange = [&](size_t t, size_t first, size_t last, pmr::memory_resource *titles) {
+        TraceSpan parsingSpan("parse", traceStarted() ? "lines " + to_string(first) + "-" + to_string(last) : "");
+        AllocationScope parsing(ALLOC_PARSE);
+        parsed[t].reserve(last - first);
+        for (size_t i = first; i < last; i++) {
+            string_view lineIn = contents.substr(lineStarts[i], lineStarts[i + 1] - 1 - lineStarts[i]);
+            parsed[t].emplace_back(lineIn, titles);
+            blank[i] = parsed[t].back().trimSpaces(lineIn).empty();
+        }
+    };
+    vector<thread> threads;
+    pmr::memory_resource *firstTitles = NULL;  // where the first range's titles go
+    for (size_t t = 0; t < threadCount; t++) {
+        size_t first = lineCount * t / threadCount;
+        size_t last = lineCount * (t + 1) / threadCount;
+        // each range gets a part of the arena to itself, about as big as its lines
+        pmr::memory_resource *titles = arena ? arena->addPart(lineStarts[last] - lineStarts[first]) : pmr::get_default_resource();
+        if (t == 0) {
+            firstTitles = titles;
+        }
+        else {
+            threads.push_back(thread(parseRange, t, first, last, titles));
+        }
+    }
+    parseRange(0, 0, lineCount / threadCount, firstTitles);
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    countPhase(STATS_READ, lineCount, contents.size());
+    countPhase(STATS_PARSE, lineCount);
+    parsing.stop();
+
+    // only load the lines that contain non-whitespace chars, and skip the deleted ones
+    // the appointments are moved, since a copy would allocate its title again, outside the arena
+    TraceSpan indexing("index records");
+    appointments.reserve(appointments.size() + lineCount);
+    for (size_t t = 0; t < threadCount; t++) {
+        size_t first = lineCount * t / threadCount;
+        for (size_t j = 0; j < parsed[t].size(); j++) {
+            if (!blank[first + j]) {
+                bool dead = tombstones.isDead(index.size());
+                index.addRecord(parsed[t][j], lineStarts[first + j]);
+                if (!dead) {
+                    appointments.push_back(move(parsed[t][j]));
+                }
+            }
+        }
+    }
+
+    return lineCount;
+}
@@ -0,0 +1,37 @@
+/**
+ *   @file: agenda_load.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Turns the contents of an agenda file into appointments and index records, parsing on several threads.
+ * 
+ * Each appointment is built in place and only moved after that, so loading copies no appointment or title.
+ */
+
+#ifndef AGENDA_LOAD_H
+#define AGENDA_LOAD_H
+
+#include <string_view>
+#include <vector>
+#include "appointment.h"
+#include "agenda_index.h"
+#include "agenda_tombstones.h"
+#include "agenda_arena.h"
+using namespace std;
+
+const size_t LINES_PER_THREAD = 16384;  // smallest share of lines worth parsing on a separate thread
+
+/**
+ * Function: parseAgenda
+ * @brief Parses every line of an agenda file, adding an index record for each line that isn't blank and
+ * an appointment for each of those that wasn't deleted.
+ * 
+ * @param contents the whole agenda file
+ * @param tombstones the records of the agenda file that were deleted
+ * @param arena where the titles are allocated, or NULL to allocate them from the default resource
+ * @param appointments vector that receives the appointments, after the ones it holds
+ * @param index index that receives the records, after the ones it holds
+ * @return the number of lines, blank ones included
+ */
+size_t parseAgenda(string_view contents, const Tombstones &tombstones, AgendaArena *arena, vector<Appointment> &appointments, AgendaIndex &index);
+
+#endif
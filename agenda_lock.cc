@@ -0,0 +1,50 @@
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "agenda_lock.h"
+using namespace std;
+
+///constructors
+
+AgendaLock::AgendaLock(const string &agendaPath) {
+    lockPath = fileName(agendaPath);
+    lockFd = -1;
+}
+
+AgendaLock::~AgendaLock() {
+    if (lockFd >= 0) {
+        close(lockFd);  // closing the file releases the lock
+    }
+}
+
+
+///locking
+
+bool AgendaLock::lock(bool exclusive, bool wait) {
+    if (lockFd < 0) {
+        lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd < 0) {
+            return false;
+        }
+    }
+
+    int operation = (exclusive ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB);
+    int result;
+    do {
+        result = flock(lockFd, operation);
+    } while (result < 0 && errno == EINTR);
+
+    return result == 0;
+}
+
+void AgendaLock::unlock() {
+    if (lockFd >= 0) {
+        flock(lockFd, LOCK_UN);
+    }
+}
+
+string AgendaLock::fileName(const string &agendaPath) {
+    return agendaPath + ".lock";
+}
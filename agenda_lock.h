@@ -0,0 +1,65 @@
+/**
+ *   @file: agenda_lock.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Advisory lock that lets processes read an agenda together but change it one at a time.
+ * 
+ * The lock is taken on a file of its own next to the agenda file, because the agenda file is
+ * replaced whenever it is rewritten and a lock on the old file would guard nothing.
+ */
+
+#ifndef AGENDA_LOCK_H
+#define AGENDA_LOCK_H
+
+#include <string>
+using namespace std;
+
+class AgendaLock {
+    public:
+        /**
+         * @brief Construct a new AgendaLock object for the lock file kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         */
+        AgendaLock(const string &agendaPath);
+
+        /**
+         * @brief Destroy the AgendaLock object, releasing the lock.
+         */
+        ~AgendaLock();
+
+        /**
+         * Function: lock
+         * @brief Takes the lock, shared for reading the agenda or exclusive for changing it.
+         * 
+         * A lock already held is converted, which isn't atomic: another process can take the lock in between.
+         * 
+         * @param exclusive whether no other process may hold the lock
+         * @param wait whether to wait for processes holding a conflicting lock
+         * @return false if the lock is held elsewhere and wait is false, or the lock file can't be opened
+         */
+        bool lock(bool exclusive, bool wait);
+
+        /**
+         * Function: unlock
+         * @brief Releases the lock.
+         */
+        void unlock();
+
+        /**
+         * Function: fileName
+         * @brief Gets the path of the lock file kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return path of the lock file
+         */
+        static string fileName(const string &agendaPath);
+    private:
+        string lockPath;  // path of the lock file, which is never removed so every process locks the same file
+        int lockFd;       // the open lock file, -1 until the first lock
+
+        AgendaLock(const AgendaLock &);
+        AgendaLock &operator =(const AgendaLock &);
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include "agenda_log.h"
+#include "agenda_index.h"
+#include "agenda_tombstones.h"
+#include "agenda_alloc_stats.h"
+using namespace std;
+
+/**
+ * Function: completeLength
+ * @brief Gets the length of a log file up to the end of its last complete line.
+ */
+static uint64_t completeLength(const string &logPath) {
+    ifstream logFile(logPath, ios::binary | ios::ate);
+    if (logFile.fail()) {
+        return 0;
+    }
+
+    // a torn line is short, so the file is read back from the end a block at a time
+    uint64_t end = logFile.tellg();
+    char block[512];
+    while (end > 0) {
+        uint64_t start = (end > sizeof(block)) ? end - sizeof(block) : 0;
+        logFile.seekg(start);
+        logFile.read(block, end - start);
+        for (uint64_t i = end; i > start; i--) {
+            if (block[i - 1 - start] == '\n') {
+                return i;
+            }
+        }
+        end = start;
+    }
+
+    return 0;
+}
+
+/**
+ * Function: isKnownType
+ * @brief Checks if a log line holds one of the operations.
+ */
+static bool isKnownType(char type) {
+    return type == LOG_ADD || type == LOG_DELETE_TITLE || type == LOG_DELETE_TIME || type == LOG_DELETE_TITLE_IGNORING_CASE;
+}
+
+
+///constructors
+
+AgendaLog::AgendaLog(const string &agendaPath) {
+    this->agendaPath = agendaPath;
+    logPath = fileName(agendaPath);
+    stale = false;
+}
+
+
+///file access
+
+bool AgendaLog::read() {
+    ops.clear();
+
+    // a pending agenda file was committed once its log is gone, and is left over from a crash otherwise
+    string pendingPath = pendingName(agendaPath);
+    if (ifstream(pendingPath).good()) {
+        if (ifstream(logPath).good()) {
+            remove(pendingPath.c_str());
+        }
+        else {
+            rename(pendingPath.c_str(), agendaPath.c_str());
+        }
+    }
+
+    // the operations of a stale log are kept in its file, but never replayed onto a file they weren't meant for
+    stale = !fitsAgenda(agendaPath);
+    if (stale) {
+        return false;
+    }
+
+    ifstream logFile(logPath, ios::binary);
+    string lineIn;
+    getline(logFile, lineIn);  // the snapshot tag
+
+    // a line cut short by a crash has no newline and is ignored
+    while (getline(logFile, lineIn) && !logFile.eof()) {
+        if (lineIn.length() >= 2 && lineIn[1] == '|' && isKnownType(lineIn[0])) {
+            LogOp op;
+            op.type = lineIn[0];
+            op.data = lineIn.substr(2);
+            ops.push_back(op);
+        }
+    }
+
+    return !ops.empty();
+}
+
+bool AgendaLog::append(char type, const string &data) {
+    // a line cut short by a crash would run into this one, so it is cut off first
+    uint64_t kept = completeLength(logPath);
+    if (kept != size() && truncate(logPath.c_str(), kept) != 0) {
+        return false;
+    }
+    if (kept > 0 && !fitsAgenda(agendaPath)) {
+        return false;
+    }
+
+    // a new log, or one whose tag was torn, is tied to the agenda file as it is now
+    ofstream logFile(logPath, ios::binary | ios::app);
+    if (kept == 0) {
+        logFile << AgendaIndex::snapshotTag(agendaPath) << '\n';
+    }
+    logFile << type << '|' << data << '\n';
+    logFile.flush();
+
+    return static_cast<bool>(logFile);
+}
+
+void AgendaLog::replay(vector<Appointment> &appointments) const {
+    for (size_t i = 0; i < ops.size(); i++) {
+        apply(ops[i], appointments);
+    }
+}
+
+void AgendaLog::apply(const LogOp &op, vector<Appointment> &appointments) {
+    if (op.type == LOG_ADD) {
+        AllocationScope parsing(ALLOC_PARSE);
+        appointments.emplace_back(op.data);
+    }
+    else if (op.type == LOG_DELETE_TITLE) {
+        appointments.erase(remove_if(appointments.begin(), appointments.end(), [&op](const Appointment &appointment) {
+            return appointment.getTitle() == string_view(op.data);
+        }), appointments.end());
+    }
+    else if (op.type == LOG_DELETE_TITLE_IGNORING_CASE) {
+        uint32_t key = Appointment::foldedHash(op.data);  // hashed once, so each appointment only compares keys
+        appointments.erase(remove_if(appointments.begin(), appointments.end(), [&op, key](const Appointment &appointment) {
+            return appointment.matchesTitle(op.data, key);
+        }), appointments.end());
+    }
+    else if (op.type == LOG_DELETE_TIME) {
+        int time = stoi(op.data);
+        appointments.erase(remove_if(appointments.begin(), appointments.end(), [time](const Appointment &appointment) {
+            return appointment.getTime() == time;
+        }), appointments.end());
+    }
+}
+
+void AgendaLog::clear() {
+    ops.clear();
+    stale = false;
+    remove(logPath.c_str());
+}
+
+bool AgendaLog::commitAgenda(const string &agendaPath, const string &writtenPath) {
+    string pendingPath = pendingName(agendaPath);
+    if (rename(writtenPath.c_str(), pendingPath.c_str()) != 0) {
+        return false;
+    }
+    remove(fileName(agendaPath).c_str());  // the commit: from here on the pending file holds the logged changes
+    remove(Tombstones::fileName(agendaPath).c_str());
+
+    return rename(pendingPath.c_str(), agendaPath.c_str()) == 0;
+}
+
+
+///getters
+
+bool AgendaLog::empty() const {
+    return ops.empty();
+}
+
+bool AgendaLog::isStale() const {
+    return stale;
+}
+
+bool AgendaLog::coveredBy(const Tombstones &tombstones) const {
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i].type == LOG_ADD) {
+            return false;
+        }
+    }
+
+    return tombstones.isCurrent();
+}
+
+const vector<LogOp> &AgendaLog::operations() const {
+    return ops;
+}
+
+uint64_t AgendaLog::size() const {
+    uint64_t size = 0;
+    int64_t mtime;
+    AgendaIndex::fileStamp(logPath, size, mtime);
+
+    return size;
+}
+
+
+///helpers
+
+bool AgendaLog::fitsAgenda(const string &agendaPath) {
+    ifstream logFile(fileName(agendaPath), ios::binary);
+    string tag;
+    if (!getline(logFile, tag) || logFile.eof()) {
+        return true;  // no log, or one cut short before its tag was complete
+    }
+
+    return tag == AgendaIndex::snapshotTag(agendaPath);
+}
+
+string AgendaLog::pendingName(const string &agendaPath) {
+    return agendaPath + ".next";
+}
+
+string AgendaLog::fileName(const string &agendaPath) {
+    return agendaPath + ".log";
+}
@@ -0,0 +1,175 @@
+/**
+ *   @file: agenda_log.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Append-only log of the mutations made since the agenda file was last written.
+ * 
+ * The log holds logical operations, meant for the agenda file as it was when the log was started, so its
+ * first line is that file's snapshot tag. Once the file is touched or edited by hand the log is stale and
+ * isn't replayed, but kept for the user to sort out. Only a rewrite by commitAgenda, which takes in every
+ * logged operation, ends the log.
+ */
+
+#ifndef AGENDA_LOG_H
+#define AGENDA_LOG_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "appointment.h"
+using namespace std;
+
+class Tombstones;
+
+const char LOG_ADD = 'A';           // operation data is an appointment string
+const char LOG_DELETE_TITLE = 'T';  // operation data is a title
+const char LOG_DELETE_TIME = 'M';   // operation data is a military time
+const char LOG_DELETE_TITLE_IGNORING_CASE = 'I';  // operation data is a title, matched in any case
+
+const uint64_t LOG_COMPACT_BYTES = 1 << 20;  // log size at which it is folded back into the agenda file
+
+struct LogOp {
+    char type;    // one of LOG_ADD, LOG_DELETE_TITLE, LOG_DELETE_TIME or LOG_DELETE_TITLE_IGNORING_CASE
+    string data;  // argument of the operation
+};
+
+class AgendaLog {
+    public:
+        /**
+         * @brief Construct a new AgendaLog object for the log kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         */
+        AgendaLog(const string &agendaPath);
+
+        /**
+         * Function: read
+         * @brief Reads every complete operation in the log, after finishing a commitAgenda cut short by a crash.
+         * 
+         * @return true if the log holds any operations, false if it holds none or is stale
+         */
+        bool read();
+
+        /**
+         * Function: append
+         * @brief Appends an operation to the end of the log, starting the log with the agenda file's snapshot tag.
+         * 
+         * @param type the type of the operation
+         * @param data the argument of the operation
+         * @return true if the operation was written, false if it failed or the log is stale
+         */
+        bool append(char type, const string &data);
+
+        /**
+         * Function: replay
+         * @brief Applies every operation read from the log, in order.
+         * 
+         * @param appointments the appointments loaded from the agenda file
+         */
+        void replay(vector<Appointment> &appointments) const;
+
+        /**
+         * Function: apply
+         * @brief Applies a single operation to a set of appointments.
+         * 
+         * @param op the operation
+         * @param appointments the appointments
+         */
+        static void apply(const LogOp &op, vector<Appointment> &appointments);
+
+        /**
+         * Function: empty
+         * @brief Checks if any operations were read from the log.
+         * 
+         * @return true if there are no operations
+         */
+        bool empty() const;
+
+        /**
+         * Function: isStale
+         * @brief Checks if the agenda file changed since the log was started, as found by the last read.
+         * 
+         * @return true if the log's operations weren't meant for the agenda file as it is now
+         */
+        bool isStale() const;
+
+        /**
+         * Function: coveredBy
+         * @brief Checks if the agenda file without its dead records is the whole agenda, because the log
+         * only holds deletes and the bitmap holds every one of them.
+         * 
+         * @param tombstones the records of the agenda file that were deleted
+         * @return true if there is nothing to replay
+         */
+        bool coveredBy(const Tombstones &tombstones) const;
+
+        /**
+         * Function: operations
+         * @brief Gets the operations read from the log.
+         * 
+         * @return the operations, in order
+         */
+        const vector<LogOp> &operations() const;
+
+        /**
+         * Function: size
+         * @brief Gets the size of the log file.
+         * 
+         * @return size of the log file in bytes, 0 if there is none
+         */
+        uint64_t size() const;
+
+        /**
+         * Function: clear
+         * @brief Removes the log file, after its operations were written to the agenda file.
+         */
+        void clear();
+
+        /**
+         * Function: commitAgenda
+         * @brief Swaps a new agenda file in for the old one, ending the log and the tombstones whose changes it holds.
+         * 
+         * The new file is first renamed to pendingName, then the log is removed, which commits the new file,
+         * and then it is renamed over the agenda file. A crash before the log is removed keeps the old
+         * file and its log; a crash after it is finished by the next read.
+         * 
+         * @param agendaPath path of the agenda file
+         * @param writtenPath path of the new agenda file, completely written
+         * @return true if the new file took the old one's place
+         */
+        static bool commitAgenda(const string &agendaPath, const string &writtenPath);
+
+        /**
+         * Function: pendingName
+         * @brief Gets the path a new agenda file waits at while commitAgenda swaps it in.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return path of the pending agenda file
+         */
+        static string pendingName(const string &agendaPath);
+
+        /**
+         * Function: fileName
+         * @brief Gets the path of the log file kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return path of the log file
+         */
+        static string fileName(const string &agendaPath);
+
+        /**
+         * Function: fitsAgenda
+         * @brief Checks if the log kept next to an agenda file was started for the file as it is now, reading only its first line.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return true if the log isn't stale, or there is no log
+         */
+        static bool fitsAgenda(const string &agendaPath);
+    private:
+        string agendaPath;  // path of the agenda file
+        string logPath;     // path of the log file
+        vector<LogOp> ops;  // operations read from the log
+        bool stale;         // whether the last read found the log started for another version of the agenda file
+};
+
+#endif
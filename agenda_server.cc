@@ -0,0 +1,274 @@
+#include <string>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <csignal>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include "agenda_server.h"
+using namespace std;
+
+static volatile sig_atomic_t stopping = 0;  // set once the server is asked to stop
+
+struct Connections {
+    mutex lock;                  // guards open
+    condition_variable closed;   // signaled whenever a connection closes
+    set<int> open;               // sockets of the connections being served
+};
+
+/**
+ * Function: stopServing
+ * @brief Signal handler that asks the server to stop after the current request.
+ */
+static void stopServing(int) {
+    stopping = 1;
+}
+
+/**
+ * Function: socketAddress
+ * @brief Fills in the address of a Unix domain socket.
+ * 
+ * @return false if the path is too long for a socket address
+ */
+static bool socketAddress(const string &socketPath, sockaddr_un &address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.length() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    return true;
+}
+
+/**
+ * Function: readLine
+ * @brief Reads the next line from a socket.
+ * 
+ * @param socketFd the socket
+ * @param pending bytes already received past the previous line, updated
+ * @param line receives the line without its newline
+ * @param maxLength the longest line taken, so a peer that never sends a newline can't grow pending without bound
+ * @return false if the connection closed before a full line arrived, or the line ran past maxLength
+ */
+static bool readLine(int socketFd, string &pending, string &line, size_t maxLength) {
+    char buffer[4096];
+    size_t newline;
+    while ((newline = pending.find('\n')) == string::npos) {
+        if (pending.length() > maxLength) {
+            return false;
+        }
+        ssize_t received = read(socketFd, buffer, sizeof(buffer));
+        if (received <= 0) {
+            return false;
+        }
+        pending.append(buffer, received);
+    }
+    if (newline > maxLength) {
+        return false;
+    }
+
+    line = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+
+    return true;
+}
+
+/**
+ * Function: sendAll
+ * @brief Writes a whole string to a socket.
+ * 
+ * @return false if the connection was lost
+ */
+static bool sendAll(int socketFd, const string &data) {
+    size_t sent = 0;
+    while (sent < data.length()) {
+        ssize_t written = send(socketFd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += written;
+    }
+
+    return true;
+}
+
+/**
+ * Function: frameResponse
+ * @brief Doubles the periods that start lines of a command's output and ends it with the terminating line.
+ */
+static string frameResponse(const string &output) {
+    string framed;
+    bool lineStart = true;
+    for (size_t i = 0; i < output.length(); i++) {
+        if (lineStart && output[i] == '.') {
+            framed += '.';
+        }
+        framed += output[i];
+        lineStart = output[i] == '\n';
+    }
+    if (!lineStart) {
+        framed += '\n';
+    }
+
+    return framed + ".\n";
+}
+
+
+/**
+ * Function: serveConnection
+ * @brief Answers the requests of one connection, each before reading the next, until the client hangs up.
+ */
+static void serveConnection(int clientFd, const function<string(const string &)> &handle, Connections &connections) {
+    string pending, line;
+    while (readLine(clientFd, pending, line, SERVER_MAX_LINE_BYTES)) {
+        if (!sendAll(clientFd, frameResponse(handle(line)))) {
+            break;
+        }
+    }
+
+    lock_guard<mutex> lock(connections.lock);
+    connections.open.erase(clientFd);
+    close(clientFd);
+    connections.closed.notify_all();
+}
+
+
+///server
+
+bool serveRequests(const string &socketPath, const function<string(const string &)> &handle, size_t maxConnections) {
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address)) {
+        return false;
+    }
+
+    // a socket file left behind by a server that crashed can be replaced, but not one that still answers
+    AgendaClient probe;
+    if (probe.connectTo(socketPath)) {
+        return false;
+    }
+    unlink(socketPath.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenFd, 16) < 0) {
+        close(listenFd);
+        return false;
+    }
+
+    // no SA_RESTART, so a signal interrupts the blocking accept and read calls
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServing;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    stopping = 0;
+
+    // connections are served on threads of their own; the signals are blocked on those threads so they
+    // always interrupt the accept call here
+    Connections connections;
+    sigset_t stopSignals, previousMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    timeval idle = {SERVER_IDLE_SECONDS, 0};
+    while (!stopping) {
+        // past the limit, new clients wait in the listen queue until a connection closes
+        {
+            unique_lock<mutex> lock(connections.lock);
+            if (connections.open.size() >= maxConnections) {
+                connections.closed.wait_for(lock, chrono::milliseconds(100));
+                continue;
+            }
+        }
+        int clientFd = accept(listenFd, NULL, NULL);
+        if (clientFd < 0) {
+            continue;
+        }
+        setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+
+        lock_guard<mutex> lock(connections.lock);
+        connections.open.insert(clientFd);
+        pthread_sigmask(SIG_BLOCK, &stopSignals, &previousMask);
+        thread(serveConnection, clientFd, cref(handle), ref(connections)).detach();
+        pthread_sigmask(SIG_SETMASK, &previousMask, NULL);
+    }
+
+    // wake the connections waiting for requests, and let the requests in progress finish
+    unique_lock<mutex> lock(connections.lock);
+    for (set<int>::iterator i = connections.open.begin(); i != connections.open.end(); ++i) {
+        shutdown(*i, SHUT_RD);
+    }
+    connections.closed.wait(lock, [&connections]() {
+        return connections.open.empty();
+    });
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+
+    return true;
+}
+
+
+///client
+
+AgendaClient::AgendaClient() {
+    socketFd = -1;
+}
+
+AgendaClient::~AgendaClient() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+}
+
+bool AgendaClient::connectTo(const string &socketPath) {
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address)) {
+        return false;
+    }
+
+    socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socketFd < 0) {
+        return false;
+    }
+    if (connect(socketFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+    pending.clear();
+
+    return true;
+}
+
+bool AgendaClient::request(const string &line, string &response) {
+    // a newline would end the request early and send the rest as a request of its own
+    response.clear();
+    if (socketFd < 0 || line.find('\n') != string::npos || !sendAll(socketFd, line + "\n")) {
+        return false;
+    }
+
+    string lineIn;
+    while (readLine(socketFd, pending, lineIn, SIZE_MAX)) {
+        if (lineIn == ".") {
+            return true;
+        }
+        response += (lineIn.length() >= 2 && lineIn[0] == '.') ? lineIn.substr(1) : lineIn;
+        response += '\n';
+    }
+
+    return false;
+}
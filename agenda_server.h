@@ -0,0 +1,76 @@
+/**
+ *   @file: agenda_server.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Line protocol for serving agenda commands over a Unix domain socket.
+ * 
+ * A request is one line holding a command's arguments, quoted like a line of a batch script.
+ * The response is the command's output followed by a line holding only a period; output lines
+ * that start with a period get a second one, which the client strips again.
+ */
+
+#ifndef AGENDA_SERVER_H
+#define AGENDA_SERVER_H
+
+#include <string>
+#include <functional>
+using namespace std;
+
+const size_t SERVER_MAX_CONNECTIONS = 64;  // connections served at once; the next ones wait to be accepted
+const int SERVER_IDLE_SECONDS = 30;        // a client that sends or takes nothing for this long is hung up on
+const size_t SERVER_MAX_LINE_BYTES = 1 << 16;  // a client that sends a longer request line is hung up on
+
+/**
+ * Function: serveRequests
+ * @brief Answers requests on a Unix domain socket, each connection on its own thread, until SIGINT or SIGTERM.
+ * 
+ * A stalled client can't hold up the others for long: it only takes up one of a bounded number of
+ * connections, and loses it after SERVER_IDLE_SECONDS. Nor can one take up memory without bound, since
+ * it loses its connection once a request line runs past SERVER_MAX_LINE_BYTES.
+ * 
+ * @param socketPath path of the socket, removed again on the way out
+ * @param handle runs a request line and returns its output; called from many threads at once
+ * @param maxConnections the number of connections served at once
+ * @return false if the socket couldn't be opened, or another server is already listening on it
+ */
+bool serveRequests(const string &socketPath, const function<string(const string &)> &handle, size_t maxConnections = SERVER_MAX_CONNECTIONS);
+
+class AgendaClient {
+    public:
+        /**
+         * @brief Construct a new AgendaClient object that isn't connected yet.
+         */
+        AgendaClient();
+
+        /**
+         * @brief Destroy the AgendaClient object, closing its connection.
+         */
+        ~AgendaClient();
+
+        /**
+         * Function: connectTo
+         * @brief Connects to a server.
+         * 
+         * @param socketPath path of the server's socket
+         * @return true if the connection was made
+         */
+        bool connectTo(const string &socketPath);
+
+        /**
+         * Function: request
+         * @brief Sends a request line and waits for its whole response.
+         * 
+         * @param line the request, without a newline
+         * @param response receives the output of the request
+         * @return false if the connection was lost, or the line holds a newline
+         */
+        bool request(const string &line, string &response);
+    private:
+        int socketFd;    // the connection, -1 if there is none
+        string pending;  // bytes received past the last full line
+
+        AgendaClient(const AgendaClient &);
+        AgendaClient &operator =(const AgendaClient &);
+};
+
+#endif
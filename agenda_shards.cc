@@ -0,0 +1,80 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "agenda_shards.h"
+#include "agenda_index.h"
+#include "agenda_log.h"
+#include "agenda_tombstones.h"
+using namespace std;
+
+const string SHARD_EXTENSION = ".txt";
+
+string shardDirectory(const string &agendaPath) {
+    return agendaPath + ".shards";
+}
+
+bool isSharded(const string &agendaPath) {
+    struct stat info;
+    return stat(shardDirectory(agendaPath).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+int shardKey(int year, int month) {
+    return year * 100 + month;
+}
+
+string shardPath(const string &agendaPath, int key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%04d-%02d", key / 100, key % 100);
+
+    return shardDirectory(agendaPath) + "/" + name + SHARD_EXTENSION;
+}
+
+vector<string> listShards(const string &agendaPath, int firstKey, int lastKey) {
+    vector<int> keys;
+    DIR *directory = opendir(shardDirectory(agendaPath).c_str());
+    if (directory == NULL) {
+        return vector<string>();
+    }
+
+    // only names shaped like a shard count, so the sidecar files next to each shard are skipped
+    for (dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory)) {
+        int year, month;
+        char extension[8];
+        if (sscanf(entry->d_name, "%d-%d%7s", &year, &month, extension) == 3 && SHARD_EXTENSION == extension) {
+            int key = shardKey(year, month);
+            if (key >= firstKey && key <= lastKey && shardPath(agendaPath, key) == shardDirectory(agendaPath) + "/" + entry->d_name) {
+                keys.push_back(key);
+            }
+        }
+    }
+    closedir(directory);
+
+    sort(keys.begin(), keys.end());
+    vector<string> paths;
+    for (size_t i = 0; i < keys.size(); i++) {
+        paths.push_back(shardPath(agendaPath, keys[i]));
+    }
+
+    return paths;
+}
+
+string findStaleShard(const string &agendaPath) {
+    vector<string> paths = listShards(agendaPath);
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!AgendaLog::fitsAgenda(paths[i])) {
+            return paths[i];
+        }
+    }
+
+    return "";
+}
+
+void removeShard(const string &path) {
+    remove(path.c_str());
+    remove(AgendaIndex::fileName(path).c_str());
+    remove(AgendaLog::fileName(path).c_str());
+    remove(Tombstones::fileName(path).c_str());
+}
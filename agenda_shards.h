@@ -0,0 +1,83 @@
+/**
+ *   @file: agenda_shards.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Layout of an agenda split into one agenda file per year and month.
+ * 
+ * The shards live in a directory next to the agenda file, named like 2021-10.txt, and each keeps
+ * its own index, log and tombstones. The agenda file itself stays behind, empty.
+ */
+
+#ifndef AGENDA_SHARDS_H
+#define AGENDA_SHARDS_H
+
+#include <string>
+#include <vector>
+#include <climits>
+using namespace std;
+
+/**
+ * Function: shardDirectory
+ * @brief Gets the path of the directory that holds the shards of an agenda file.
+ * 
+ * @param agendaPath path of the agenda file
+ * @return path of the shard directory
+ */
+string shardDirectory(const string &agendaPath);
+
+/**
+ * Function: isSharded
+ * @brief Tells whether an agenda is split into shards.
+ * 
+ * @param agendaPath path of the agenda file
+ * @return true if the shard directory exists
+ */
+bool isSharded(const string &agendaPath);
+
+/**
+ * Function: shardKey
+ * @brief Gets the key of the shard that holds a year and month, ordered like the months.
+ * 
+ * @return the key, as YYYYMM
+ */
+int shardKey(int year, int month);
+
+/**
+ * Function: shardPath
+ * @brief Gets the path of the shard with a key.
+ * 
+ * @param agendaPath path of the agenda file
+ * @param key the shard's key
+ * @return path of the shard's agenda file
+ */
+string shardPath(const string &agendaPath, int key);
+
+/**
+ * Function: listShards
+ * @brief Finds the shards of an agenda whose keys are in a range, in key order.
+ * 
+ * @param agendaPath path of the agenda file
+ * @param firstKey the first key of the range
+ * @param lastKey the last key of the range
+ * @return paths of the shards' agenda files
+ */
+vector<string> listShards(const string &agendaPath, int firstKey = 0, int lastKey = INT_MAX);
+
+/**
+ * Function: findStaleShard
+ * @brief Finds a shard whose agenda file changed since its log was started.
+ * 
+ * @param agendaPath path of the agenda file
+ * @return path of the first stale shard's agenda file, or an empty string if there is none
+ */
+string findStaleShard(const string &agendaPath);
+
+/**
+ * Function: removeShard
+ * @brief Removes a shard's agenda file along with its index, log and tombstones.
+ * 
+ * @param path path of the shard's agenda file
+ */
+void removeShard(const string &path);
+
+#endif
@@ -0,0 +1,221 @@
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <iterator>
+#include "agenda_snapshots.h"
+#include "agenda_index.h"
+#include "agenda_trace.h"
+using namespace std;
+
+///constructors
+
+Snapshot::Snapshot() {
+    base = make_shared<vector<Appointment> >();
+    baseByTime = make_shared<vector<uint32_t> >();
+    baseByDate = make_shared<vector<uint32_t> >();
+    baseTitles = make_shared<TitleSearch>();
+}
+
+AgendaSnapshots::AgendaSnapshots() {
+    latest = make_shared<Snapshot>();
+    copyOnWrite = false;
+}
+
+
+///reading
+
+size_t Snapshot::size() const {
+    return base->size() + recent.size();
+}
+
+const Appointment &Snapshot::at(size_t position) const {
+    return (position < base->size()) ? (*base)[position] : recent[position - base->size()];
+}
+
+void Snapshot::collect(vector<Appointment> &appointments) const {
+    appointments.insert(appointments.end(), base->begin(), base->end());
+    appointments.insert(appointments.end(), recent.begin(), recent.end());
+}
+
+void Snapshot::page(int fromTime, int toTime, size_t skip, size_t limit, vector<Appointment> &appointments) const {
+    mergePage(*baseByTime, recentByTime, [](const Appointment &appointment) {
+        return static_cast<uint64_t>(appointment.getTime());
+    }, fromTime, toTime, skip, limit, appointments);
+}
+
+void Snapshot::pageDates(uint64_t fromKey, uint64_t toKey, size_t skip, size_t limit, vector<Appointment> &appointments) const {
+    mergePage(*baseByDate, recentByDate, [](const Appointment &appointment) {
+        return AgendaIndex::chronoKey(appointment);
+    }, fromKey, toKey + 1, skip, limit, appointments);
+}
+
+void Snapshot::findTitles(string_view text, bool prefix, size_t skip, size_t limit, vector<Appointment> &appointments) const {
+    call_once(baseTitles->built, [this]() {
+        baseTitles->index.build(*base);
+    });
+    vector<uint32_t> positions = prefix ? baseTitles->index.startingWith(text) : baseTitles->index.containing(text);
+
+    // the recent appointments come after the base in agenda order
+    string folded(text);
+    Appointment::foldCase(folded.data(), folded.length());
+    for (size_t i = 0; i < recent.size(); i++) {
+        if (TrigramIndex::titleMatches(recent[i].getTitle(), folded, prefix)) {
+            positions.push_back(base->size() + i);
+        }
+    }
+
+    for (size_t i = skip; i < positions.size() && limit > 0; i++, limit--) {
+        appointments.push_back(at(positions[i]));
+    }
+}
+
+
+///changing
+
+void Snapshot::add(const Appointment &appointment) {
+    recent.push_back(appointment);
+    insertRecent(recentByTime, [](const Appointment &appointment) {
+        return static_cast<uint64_t>(appointment.getTime());
+    });
+    insertRecent(recentByDate, [](const Appointment &appointment) {
+        return AgendaIndex::chronoKey(appointment);
+    });
+
+    // fold the recent appointments into a new base once copying them with every version costs too much;
+    // positions don't change, and a stable merge keeps ties in agenda order
+    if (recent.size() >= SNAPSHOT_RECENT_LIMIT) {
+        shared_ptr<vector<uint32_t> > mergedByTime = make_shared<vector<uint32_t> >();
+        mergedByTime->reserve(size());
+        merge(baseByTime->begin(), baseByTime->end(), recentByTime.begin(), recentByTime.end(), back_inserter(*mergedByTime), [this](uint32_t first, uint32_t second) {
+            return at(first).getTime() < at(second).getTime();
+        });
+        shared_ptr<vector<uint32_t> > mergedByDate = make_shared<vector<uint32_t> >();
+        mergedByDate->reserve(size());
+        merge(baseByDate->begin(), baseByDate->end(), recentByDate.begin(), recentByDate.end(), back_inserter(*mergedByDate), [this](uint32_t first, uint32_t second) {
+            return AgendaIndex::chronoKey(at(first)) < AgendaIndex::chronoKey(at(second));
+        });
+        shared_ptr<vector<Appointment> > folded = make_shared<vector<Appointment> >();
+        folded->reserve(size());
+        collect(*folded);
+        base = folded;
+        baseByTime = mergedByTime;
+        baseByDate = mergedByDate;
+        baseTitles = make_shared<TitleSearch>();
+        recent.clear();
+        recentByTime.clear();
+        recentByDate.clear();
+    }
+}
+
+void Snapshot::replace(const vector<Appointment> &appointments) {
+    base = make_shared<vector<Appointment> >(appointments);
+    baseTitles = make_shared<TitleSearch>();
+    recent.clear();
+    recentByTime.clear();
+    recentByDate.clear();
+    sortByTime();
+}
+
+void Snapshot::sortByTime() {
+    TraceSpan span("sort by time");
+    // times fall in [0, TIME_BUCKETS), so a counting sort keeps ties in agenda order in linear time
+    vector<uint32_t> bucketStart(TIME_BUCKETS + 1, 0);
+    for (size_t i = 0; i < base->size(); i++) {
+        bucketStart[(*base)[i].getTime() + 1]++;
+    }
+    for (int t = 0; t < TIME_BUCKETS; t++) {
+        bucketStart[t + 1] += bucketStart[t];
+    }
+
+    shared_ptr<vector<uint32_t> > sorted = make_shared<vector<uint32_t> >(base->size());
+    for (size_t i = 0; i < base->size(); i++) {
+        (*sorted)[bucketStart[(*base)[i].getTime()]++] = i;
+    }
+    baseByTime = sorted;
+
+    // ordering the time order by date alone, stably, leaves ties in time in agenda order
+    shared_ptr<vector<uint32_t> > byDate = make_shared<vector<uint32_t> >(*sorted);
+    stable_sort(byDate->begin(), byDate->end(), [this](uint32_t first, uint32_t second) {
+        const Appointment &firstAppointment = (*base)[first];
+        const Appointment &secondAppointment = (*base)[second];
+        return AgendaIndex::packDate(firstAppointment.getYear(), firstAppointment.getMonth(), firstAppointment.getDay())
+            < AgendaIndex::packDate(secondAppointment.getYear(), secondAppointment.getMonth(), secondAppointment.getDay());
+    });
+    baseByDate = byDate;
+}
+
+template <typename Key>
+void Snapshot::mergePage(const vector<uint32_t> &baseOrder, const vector<uint32_t> &recentOrder, Key key, uint64_t fromKey, uint64_t toKey,
+                         size_t skip, size_t limit, vector<Appointment> &appointments) const {
+    // the matches are one run of each ordering, and base comes first in agenda order, so it wins ties
+    auto keyBefore = [this, &key](uint32_t position, uint64_t value) {
+        return key(at(position)) < value;
+    };
+    vector<uint32_t>::const_iterator baseNext = lower_bound(baseOrder.begin(), baseOrder.end(), fromKey, keyBefore);
+    vector<uint32_t>::const_iterator baseLast = lower_bound(baseNext, baseOrder.end(), toKey, keyBefore);
+    vector<uint32_t>::const_iterator recentNext = lower_bound(recentOrder.begin(), recentOrder.end(), fromKey, keyBefore);
+    vector<uint32_t>::const_iterator recentLast = lower_bound(recentNext, recentOrder.end(), toKey, keyBefore);
+
+    // skip whole runs of base between the recent matches, so a deep page costs little more than the first
+    while (skip > 0 && recentNext != recentLast) {
+        vector<uint32_t>::const_iterator before = lower_bound(baseNext, baseLast, key(at(*recentNext)) + 1, keyBefore);
+        size_t skipped = min<size_t>(skip, before - baseNext);
+        baseNext += skipped;
+        skip -= skipped;
+        if (skip > 0) {
+            ++recentNext;
+            skip--;
+        }
+    }
+    baseNext += min<size_t>(skip, baseLast - baseNext);
+
+    while ((baseNext != baseLast || recentNext != recentLast) && limit > 0) {
+        bool fromBase = recentNext == recentLast || (baseNext != baseLast && key(at(*baseNext)) <= key(at(*recentNext)));
+        appointments.push_back(at(fromBase ? *baseNext++ : *recentNext++));
+        limit--;
+    }
+}
+
+template <typename Key>
+void Snapshot::insertRecent(vector<uint32_t> &recentOrder, Key key) {
+    // the new appointment is last in agenda order, so it goes after every other appointment with its key
+    uint64_t value = key(recent.back());
+    recentOrder.insert(upper_bound(recentOrder.begin(), recentOrder.end(), value, [this, &key](uint64_t value, uint32_t position) {
+        return value < key(at(position));
+    }), size() - 1);
+}
+
+
+///versions
+
+void AgendaSnapshots::reset(const vector<Appointment> &appointments) {
+    shared_ptr<Snapshot> first = make_shared<Snapshot>();
+    first->replace(appointments);
+
+    lock_guard<mutex> lock(writing);
+    atomic_store(&latest, first);
+}
+
+shared_ptr<const Snapshot> AgendaSnapshots::current() const {
+    return atomic_load(&latest);
+}
+
+bool AgendaSnapshots::change(const function<bool(Snapshot &)> &edit) {
+    lock_guard<mutex> lock(writing);
+
+    // readers keep the version they loaded, so the next one is built on the side and swapped in whole
+    shared_ptr<Snapshot> next = copyOnWrite ? make_shared<Snapshot>(*latest) : latest;
+    if (!edit(*next)) {
+        return false;
+    }
+    atomic_store(&latest, next);
+
+    return true;
+}
+
+void AgendaSnapshots::setCopyOnWrite(bool copyOnWrite) {
+    this->copyOnWrite = copyOnWrite;
+}
@@ -0,0 +1,202 @@
+/**
+ *   @file: agenda_snapshots.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Versions of an agenda held in memory, read without blocking while changes build the next version.
+ */
+
+#ifndef AGENDA_SNAPSHOTS_H
+#define AGENDA_SNAPSHOTS_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include "appointment.h"
+#include "trigram_index.h"
+using namespace std;
+
+const size_t SNAPSHOT_RECENT_LIMIT = 1024;  // appointments added to a version before they are folded into its shared base
+
+struct TitleSearch {
+    once_flag built;     // the index is built by the first search, on whichever thread makes it
+    TrigramIndex index;  // titles of a shared base
+};
+
+class Snapshot {
+    public:
+        /**
+         * @brief Construct a new empty Snapshot object.
+         */
+        Snapshot();
+
+        /**
+         * Function: size
+         * @brief Gets the number of appointments in the version.
+         * 
+         * @return number of appointments
+         */
+        size_t size() const;
+
+        /**
+         * Function: at
+         * @brief Gets an appointment by its position in agenda order.
+         * 
+         * @param position the position
+         * @return the appointment
+         */
+        const Appointment &at(size_t position) const;
+
+        /**
+         * Function: collect
+         * @brief Copies every appointment, in agenda order.
+         * 
+         * @param appointments vector that receives the appointments
+         */
+        void collect(vector<Appointment> &appointments) const;
+
+        /**
+         * Function: page
+         * @brief Gets one page of the appointments starting in a time range, ordered by time with ties in agenda order.
+         * 
+         * @param fromTime the first starting time in military format
+         * @param toTime the starting time after the range in military format
+         * @param skip the number of matching appointments to skip
+         * @param limit the maximum number of appointments to return
+         * @param appointments vector that receives the page
+         */
+        void page(int fromTime, int toTime, size_t skip, size_t limit, vector<Appointment> &appointments) const;
+
+        /**
+         * Function: pageDates
+         * @brief Gets one page of the appointments starting between two dates and times, in chronological order with ties in agenda order.
+         * 
+         * @param fromKey the first starting date and time, as returned by AgendaIndex::chronoKey
+         * @param toKey the last starting date and time, as returned by AgendaIndex::chronoKey
+         * @param skip the number of matching appointments to skip
+         * @param limit the maximum number of appointments to return
+         * @param appointments vector that receives the page
+         */
+        void pageDates(uint64_t fromKey, uint64_t toKey, size_t skip, size_t limit, vector<Appointment> &appointments) const;
+
+        /**
+         * Function: findTitles
+         * @brief Gets one page of the appointments whose titles contain or start with some text in any case, in agenda order.
+         * 
+         * The titles of the shared base are indexed by the first search of any version built on it;
+         * the recent appointments are checked one by one.
+         * 
+         * @param text the text
+         * @param prefix whether the titles have to start with the text instead of containing it
+         * @param skip the number of matching appointments to skip
+         * @param limit the maximum number of appointments to return
+         * @param appointments vector that receives the page
+         */
+        void findTitles(string_view text, bool prefix, size_t skip, size_t limit, vector<Appointment> &appointments) const;
+
+        /**
+         * Function: add
+         * @brief Adds an appointment to the end of the version.
+         * 
+         * Only the recent appointments and their orders are copied between versions, so adding
+         * doesn't copy the whole agenda until SNAPSHOT_RECENT_LIMIT of them pile up.
+         * 
+         * @param appointment the new appointment
+         */
+        void add(const Appointment &appointment);
+
+        /**
+         * Function: replace
+         * @brief Replaces every appointment in the version.
+         * 
+         * @param appointments the whole agenda
+         */
+        void replace(const vector<Appointment> &appointments);
+    private:
+        shared_ptr<const vector<Appointment> > base;    // appointments shared by every version since it was built
+        shared_ptr<const vector<uint32_t> > baseByTime;  // positions in base ordered by starting time, ties in agenda order, shared with base
+        vector<Appointment> recent;                      // appointments added after base, copied with each version
+        vector<uint32_t> recentByTime;                   // positions of the recent appointments ordered the same way, copied with them
+        shared_ptr<const vector<uint32_t> > baseByDate;  // positions in base ordered by starting date and time, ties in agenda order, shared with base
+        vector<uint32_t> recentByDate;                   // positions of the recent appointments ordered the same way, copied with them
+        shared_ptr<TitleSearch> baseTitles;              // index of the titles in base, shared with base
+
+        /**
+         * Function: sortByTime
+         * @brief Rebuilds baseByTime with a counting sort over the starting times in base, and baseByDate from it.
+         */
+        void sortByTime();
+
+        /**
+         * Function: mergePage
+         * @brief Gets one page of the appointments whose keys fall in a range, merging the order of base with the recent one.
+         * 
+         * @param baseOrder positions in base ordered by key
+         * @param recentOrder positions of the recent appointments ordered by key
+         * @param key gets the key of an appointment
+         * @param fromKey the first key in the range
+         * @param toKey the key after the range
+         * @param skip the number of matching appointments to skip
+         * @param limit the maximum number of appointments to return
+         * @param appointments vector that receives the page
+         */
+        template <typename Key>
+        void mergePage(const vector<uint32_t> &baseOrder, const vector<uint32_t> &recentOrder, Key key, uint64_t fromKey, uint64_t toKey,
+                       size_t skip, size_t limit, vector<Appointment> &appointments) const;
+
+        /**
+         * Function: insertRecent
+         * @brief Puts the last recent appointment into a recent order, after every other appointment with the same key.
+         */
+        template <typename Key>
+        void insertRecent(vector<uint32_t> &recentOrder, Key key);
+};
+
+class AgendaSnapshots {
+    public:
+        /**
+         * @brief Construct a new AgendaSnapshots object holding an empty agenda.
+         */
+        AgendaSnapshots();
+
+        /**
+         * Function: reset
+         * @brief Replaces the agenda with a first version.
+         * 
+         * @param appointments the whole agenda
+         */
+        void reset(const vector<Appointment> &appointments);
+
+        /**
+         * Function: current
+         * @brief Gets the latest version, which never changes while it is held if copy on write is on.
+         * 
+         * @return the latest version
+         */
+        shared_ptr<const Snapshot> current() const;
+
+        /**
+         * Function: change
+         * @brief Builds and publishes the next version; changes are made one at a time, in the order they are published.
+         * 
+         * @param edit changes the next version, and returns false to drop it
+         * @return true if the next version was published
+         */
+        bool change(const function<bool(Snapshot &)> &edit);
+
+        /**
+         * Function: setCopyOnWrite
+         * @brief Chooses between copying each version before changing it, so other threads can keep reading
+         * the versions they hold, and changing the latest version in place.
+         * 
+         * @param copyOnWrite whether other threads may be reading
+         */
+        void setCopyOnWrite(bool copyOnWrite);
+    private:
+        shared_ptr<Snapshot> latest;  // the latest version, only replaced through atomic_store
+        mutex writing;                // held while a change builds and publishes the next version
+        bool copyOnWrite;             // whether changes are made to a copy of the latest version
+};
+
+#endif
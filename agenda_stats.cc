@@ -0,0 +1,142 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <mutex>
+#include <ctime>
+#include "agenda_stats.h"
+#include "agenda_trace.h"
+using namespace std;
+
+const char *STATS_PHASE_NAMES[STATS_PHASES] = {"open", "read", "parse", "execute", "output", "write"};
+
+static bool enabled = false;
+static bool jsonOutput = false;
+static PhaseStats phases[STATS_PHASES];
+static mutex phasesMutex;                             // server requests time their phases on their own threads
+static thread_local PhaseTimer *currentTimer = NULL;  // innermost timer running on this thread
+
+/**
+ * Function: readClock
+ * @brief Reads a clock in seconds.
+ */
+static double readClock(clockid_t clock) {
+    timespec now;
+    clock_gettime(clock, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+///constructors
+
+PhaseTimer::PhaseTimer(int phase) {
+    this->phase = enabled ? phase : -1;
+    if (this->phase < 0) {
+        return;
+    }
+
+    wallStart = readClock(CLOCK_MONOTONIC);
+    cpuStart = readClock(CLOCK_PROCESS_CPUTIME_ID);
+    wallInside = 0;
+    cpuInside = 0;
+    outer = currentTimer;
+    currentTimer = this;
+}
+
+PhaseTimer::~PhaseTimer() {
+    stop();
+}
+
+
+///timing
+
+void PhaseTimer::stop() {
+    if (phase < 0) {
+        return;
+    }
+
+    double wall = readClock(CLOCK_MONOTONIC) - wallStart;
+    double cpu = readClock(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    currentTimer = outer;
+    if (outer != NULL) {
+        outer->wallInside += wall;
+        outer->cpuInside += cpu;
+    }
+
+    lock_guard<mutex> guard(phasesMutex);
+    phases[phase].wallSeconds += wall - wallInside;
+    phases[phase].cpuSeconds += cpu - cpuInside;
+    phase = -1;
+}
+
+
+///collecting
+
+void enableStats(bool json) {
+    lock_guard<mutex> guard(phasesMutex);
+    enabled = true;
+    jsonOutput = json;
+    for (int i = 0; i < STATS_PHASES; i++) {
+        phases[i] = PhaseStats();
+    }
+}
+
+bool statsEnabled() {
+    return enabled;
+}
+
+void countPhase(int phase, uint64_t records, uint64_t bytesRead, uint64_t bytesWritten) {
+    if (!enabled) {
+        return;
+    }
+
+    lock_guard<mutex> guard(phasesMutex);
+    phases[phase].records += records;
+    phases[phase].bytesRead += bytesRead;
+    phases[phase].bytesWritten += bytesWritten;
+}
+
+PhaseStats phaseStats(int phase) {
+    lock_guard<mutex> guard(phasesMutex);
+
+    return phases[phase];
+}
+
+
+///reporting
+
+void reportStats(ostream &out, const string &command) {
+    PhaseStats total = PhaseStats();
+    PhaseStats collected[STATS_PHASES];
+    for (int i = 0; i < STATS_PHASES; i++) {
+        collected[i] = phaseStats(i);
+        total.wallSeconds += collected[i].wallSeconds;
+        total.cpuSeconds += collected[i].cpuSeconds;
+        total.bytesRead += collected[i].bytesRead;
+        total.bytesWritten += collected[i].bytesWritten;
+    }
+
+    out << fixed << setprecision(3);
+    if (jsonOutput) {
+        out << "{\"command\":" << jsonString(command) << ",\"phases\":[";
+        for (int i = 0; i < STATS_PHASES; i++) {
+            out << (i > 0 ? "," : "") << "{\"name\":\"" << STATS_PHASE_NAMES[i] << "\",\"wall_ms\":" << collected[i].wallSeconds * 1e3
+                << ",\"cpu_ms\":" << collected[i].cpuSeconds * 1e3 << ",\"records\":" << collected[i].records
+                << ",\"bytes_read\":" << collected[i].bytesRead << ",\"bytes_written\":" << collected[i].bytesWritten << "}";
+        }
+        out << "],\"wall_ms\":" << total.wallSeconds * 1e3 << ",\"cpu_ms\":" << total.cpuSeconds * 1e3
+            << ",\"bytes_read\":" << total.bytesRead << ",\"bytes_written\":" << total.bytesWritten << "}" << endl;
+        return;
+    }
+
+    out << "stats for " << command << endl;
+    out << left << setw(10) << "phase" << right << setw(12) << "wall ms" << setw(12) << "cpu ms" << setw(12) << "records"
+        << setw(14) << "bytes read" << setw(14) << "bytes written" << endl;
+    for (int i = 0; i < STATS_PHASES; i++) {
+        out << left << setw(10) << STATS_PHASE_NAMES[i] << right << setw(12) << collected[i].wallSeconds * 1e3
+            << setw(12) << collected[i].cpuSeconds * 1e3 << setw(12) << collected[i].records
+            << setw(14) << collected[i].bytesRead << setw(14) << collected[i].bytesWritten << endl;
+    }
+    // records of different phases count different things, so they have no total
+    out << left << setw(10) << "total" << right << setw(12) << total.wallSeconds * 1e3 << setw(12) << total.cpuSeconds * 1e3
+        << setw(12) << "" << setw(14) << total.bytesRead << setw(14) << total.bytesWritten << endl;
+}
@@ -0,0 +1,111 @@
+/**
+ *   @file: agenda_stats.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Wall time, CPU time, records and bytes spent in each phase of a command, for --stats.
+ * 
+ * A PhaseTimer charges the time until it ends to its phase, less the time of the timers started inside
+ * it, so the phases add up to the whole command. Nothing is timed or counted until stats are enabled.
+ */
+
+#ifndef AGENDA_STATS_H
+#define AGENDA_STATS_H
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+using namespace std;
+
+const int STATS_OPEN = 0;     // checking the agenda file, locking it, reading the log and tombstones
+const int STATS_READ = 1;     // reading lines of the agenda file
+const int STATS_PARSE = 2;    // turning lines into appointments
+const int STATS_EXECUTE = 3;  // the rest of the command: searching, sorting, grouping
+const int STATS_OUTPUT = 4;   // printing the results
+const int STATS_WRITE = 5;    // saving the agenda file and its sidecars
+const int STATS_PHASES = 6;
+
+struct PhaseStats {
+    double wallSeconds;     // elapsed time
+    double cpuSeconds;      // CPU time of every thread of the process
+    uint64_t records;       // lines read, appointments parsed, results printed or lines written
+    uint64_t bytesRead;     // bytes read from files
+    uint64_t bytesWritten;  // bytes written to files or printed
+};
+
+class PhaseTimer {
+    public:
+        /**
+         * @brief Construct a new PhaseTimer object, starting to time a phase if stats are enabled.
+         * 
+         * @param phase one of the STATS_ phases
+         */
+        PhaseTimer(int phase);
+
+        /**
+         * @brief Destroy the PhaseTimer object, charging the time since it started to its phase.
+         */
+        ~PhaseTimer();
+
+        /**
+         * Function: stop
+         * @brief Charges the time since the timer started to its phase, if it is still running.
+         */
+        void stop();
+    private:
+        int phase;            // the phase being timed, -1 if stats are disabled or the timer stopped
+        double wallStart;     // wall clock when the timer started
+        double cpuStart;      // CPU clock when the timer started
+        double wallInside;    // wall time of the timers started inside this one
+        double cpuInside;     // CPU time of the timers started inside this one
+        PhaseTimer *outer;    // the timer running when this one started, on this thread
+
+        PhaseTimer(const PhaseTimer &);
+        PhaseTimer &operator =(const PhaseTimer &);
+};
+
+/**
+ * Function: enableStats
+ * @brief Starts collecting stats, from zero.
+ * 
+ * @param json whether reportStats prints JSON instead of text
+ */
+void enableStats(bool json);
+
+/**
+ * Function: statsEnabled
+ * @brief Tells whether stats are being collected, so callers can skip working out what to count.
+ * 
+ * @return true once enableStats was called
+ */
+bool statsEnabled();
+
+/**
+ * Function: countPhase
+ * @brief Adds records and bytes to a phase, if stats are enabled.
+ * 
+ * @param phase one of the STATS_ phases
+ * @param records number of records processed
+ * @param bytesRead number of bytes read
+ * @param bytesWritten number of bytes written
+ */
+void countPhase(int phase, uint64_t records, uint64_t bytesRead = 0, uint64_t bytesWritten = 0);
+
+/**
+ * Function: phaseStats
+ * @brief Gets what was collected for a phase so far.
+ * 
+ * @param phase one of the STATS_ phases
+ * @return the phase's stats
+ */
+PhaseStats phaseStats(int phase);
+
+/**
+ * Function: reportStats
+ * @brief Prints the stats of every phase and their total, as one line per phase or as one JSON object.
+ * 
+ * @param out stream to print to
+ * @param command the command the stats belong to
+ */
+void reportStats(ostream &out, const string &command);
+
+#endif
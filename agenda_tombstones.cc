@@ -0,0 +1,128 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include "agenda_tombstones.h"
+#include "agenda_index.h"
+#include "agenda_log.h"
+using namespace std;
+
+///constructors
+
+Tombstones::Tombstones(const string &agendaPath) {
+    this->agendaPath = agendaPath;
+    deadPath = fileName(agendaPath);
+    count = 0;
+    current = true;
+}
+
+
+///file access
+
+bool Tombstones::read() {
+    ifstream deadFile(deadPath, ios::binary);
+    string tag, countLine;
+    dead.clear();
+    count = 0;
+
+    if (deadFile.fail()) {
+        current = AgendaLog(agendaPath).size() == 0;  // no delete was logged since the last compaction
+        return false;
+    }
+    current = getline(deadFile, tag) && tag == versionTag() && getline(deadFile, countLine);
+    if (!current) {
+        return false;  // the log still holds the deletes, and the next one saves a new bitmap
+    }
+
+    // the bits are packed eight records to a byte
+    dead.resize(stoull(countLine));
+    vector<char> packed((dead.size() + 7) / 8);
+    deadFile.read(packed.data(), packed.size());
+    for (size_t i = 0; i < dead.size(); i++) {
+        if (packed[i / 8] & (1 << (i % 8))) {
+            dead[i] = true;
+            count++;
+        }
+    }
+
+    return count > 0;
+}
+
+bool Tombstones::save() {
+    vector<char> packed((dead.size() + 7) / 8, 0);
+    for (size_t i = 0; i < dead.size(); i++) {
+        if (dead[i]) {
+            packed[i / 8] |= (1 << (i % 8));
+        }
+    }
+
+    ofstream deadFile(deadPath, ios::binary | ios::trunc);
+    deadFile << versionTag() << '\n' << dead.size() << '\n';
+    deadFile.write(packed.data(), packed.size());
+    current = static_cast<bool>(deadFile);
+
+    return current;
+}
+
+void Tombstones::clear() {
+    dead.clear();
+    count = 0;
+    current = true;
+    remove(deadPath.c_str());
+}
+
+
+///modifiers
+
+bool Tombstones::mark(size_t record) {
+    if (record >= dead.size()) {
+        dead.resize(record + 1);
+    }
+    if (dead[record]) {
+        return false;
+    }
+    dead[record] = true;
+    count++;
+
+    return true;
+}
+
+void Tombstones::resize(size_t records) {
+    if (records > dead.size()) {
+        dead.resize(records);
+    }
+}
+
+
+///getters
+
+bool Tombstones::isDead(size_t record) const {
+    return record < dead.size() && dead[record];
+}
+
+size_t Tombstones::deadCount() const {
+    return count;
+}
+
+double Tombstones::deadFraction() const {
+    if (dead.empty()) {
+        return 0;
+    }
+
+    return static_cast<double>(count) / dead.size();
+}
+
+bool Tombstones::isCurrent() const {
+    return current;
+}
+
+
+///helpers
+
+string Tombstones::versionTag() const {
+    return AgendaIndex::snapshotTag(agendaPath) + '|' + to_string(AgendaLog(agendaPath).size());
+}
+
+string Tombstones::fileName(const string &agendaPath) {
+    return agendaPath + ".dead";
+}
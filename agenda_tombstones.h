@@ -0,0 +1,124 @@
+/**
+ *   @file: agenda_tombstones.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Bitmap of the records deleted from the agenda file but not yet removed from it.
+ * 
+ * The bitmap only speeds up reads: every delete is logged as well, and the record numbers only hold for
+ * the version of the agenda file it was saved for. A bitmap saved for another version of the file, or
+ * before the last operation was logged, is ignored until the next delete rebuilds it from the log.
+ */
+
+#ifndef AGENDA_TOMBSTONES_H
+#define AGENDA_TOMBSTONES_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+const double DEAD_COMPACT_FRACTION = 0.25;  // share of dead records at which the agenda file is rewritten
+
+class Tombstones {
+    public:
+        /**
+         * @brief Construct a new Tombstones object for the bitmap kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         */
+        Tombstones(const string &agendaPath);
+
+        /**
+         * Function: read
+         * @brief Reads the bitmap file, unless it is stale.
+         * 
+         * @return true if any record is dead
+         */
+        bool read();
+
+        /**
+         * Function: save
+         * @brief Writes the bitmap file, tied to the current version of the agenda file and of its log.
+         * 
+         * @return true if the bitmap file was written
+         */
+        bool save();
+
+        /**
+         * Function: mark
+         * @brief Marks a record as dead.
+         * 
+         * @param record the record number in the agenda file
+         * @return true if the record wasn't dead already
+         */
+        bool mark(size_t record);
+
+        /**
+         * Function: isDead
+         * @brief Checks if a record was deleted.
+         * 
+         * @param record the record number in the agenda file
+         * @return true if the record is dead
+         */
+        bool isDead(size_t record) const;
+
+        /**
+         * Function: resize
+         * @brief Sets the number of records in the agenda file.
+         * 
+         * @param records the number of records
+         */
+        void resize(size_t records);
+
+        /**
+         * Function: deadCount
+         * @brief Gets the number of dead records.
+         * 
+         * @return number of dead records
+         */
+        size_t deadCount() const;
+
+        /**
+         * Function: deadFraction
+         * @brief Gets the share of the agenda file's records that are dead.
+         * 
+         * @return dead records divided by all records, 0 if there are none
+         */
+        double deadFraction() const;
+
+        /**
+         * Function: isCurrent
+         * @brief Checks if the bitmap holds every delete in the log, for the current version of the agenda file.
+         * 
+         * @return true if the bitmap isn't stale
+         */
+        bool isCurrent() const;
+
+        /**
+         * Function: clear
+         * @brief Removes the bitmap file, after the dead records were removed from the agenda file.
+         */
+        void clear();
+
+        /**
+         * Function: fileName
+         * @brief Gets the path of the bitmap file kept next to an agenda file.
+         * 
+         * @param agendaPath path of the agenda file
+         * @return path of the bitmap file
+         */
+        static string fileName(const string &agendaPath);
+    private:
+        /**
+         * Function: versionTag
+         * @brief Gets the tag of the current versions of the agenda file and its log.
+         */
+        string versionTag() const;
+
+        string agendaPath;  // path of the agenda file
+        string deadPath;    // path of the bitmap file
+        vector<bool> dead;  // one bit per record in the agenda file
+        size_t count;       // number of set bits in dead
+        bool current;       // whether the bitmap was read or saved for the current agenda file and log
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unistd.h>
+#include "agenda_trace.h"
+using namespace std;
+
+struct TraceEvent {
+    const char *name;  // what the span covered
+    string detail;     // shown with the span
+    double start;      // microseconds since tracing started
+    double duration;   // microseconds
+    int thread;        // small number for the thread the span ran on
+};
+
+static atomic<bool> tracing(false);
+static chrono::steady_clock::time_point traceStart;
+static vector<TraceEvent> events;  // spans that ended, in the order they ended
+static mutex eventsMutex;
+static atomic<int> threadCount(0);
+static thread_local int threadNumber = 0;  // given out when a thread records its first span
+
+/**
+ * Function: now
+ * @brief Gets the microseconds since tracing started.
+ */
+static double now() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - traceStart).count();
+}
+
+///constructors
+
+TraceSpan::TraceSpan(const char *name, const string &detail) {
+    if (!tracing.load(memory_order_relaxed)) {
+        this->name = NULL;
+        return;
+    }
+
+    this->name = name;
+    this->detail = detail;
+    start = now();
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+
+///tracing
+
+void TraceSpan::end() {
+    if (name == NULL) {
+        return;
+    }
+
+    TraceEvent event = {name, detail, start, now() - start, threadNumber};
+    if (event.thread == 0) {
+        event.thread = threadNumber = ++threadCount;
+    }
+    name = NULL;
+    lock_guard<mutex> guard(eventsMutex);
+    events.push_back(event);
+}
+
+void startTrace() {
+    lock_guard<mutex> guard(eventsMutex);
+    events.clear();
+    traceStart = chrono::steady_clock::now();
+    tracing = true;
+}
+
+bool traceStarted() {
+    return tracing.load(memory_order_relaxed);
+}
+
+string traceJson() {
+    lock_guard<mutex> guard(eventsMutex);
+    ostringstream json;
+    json << fixed << setprecision(3) << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++) {
+        // complete events, which carry their own duration
+        json << (i > 0 ? ",\n" : "\n") << "{\"name\":" << jsonString(events[i].name) << ",\"cat\":\"agenda\",\"ph\":\"X\""
+             << ",\"ts\":" << events[i].start << ",\"dur\":" << events[i].duration
+             << ",\"pid\":" << getpid() << ",\"tid\":" << events[i].thread;
+        if (!events[i].detail.empty()) {
+            json << ",\"args\":{\"detail\":" << jsonString(events[i].detail) << "}";
+        }
+        json << "}";
+    }
+    json << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return json.str();
+}
+
+bool saveTrace(const string &path) {
+    ofstream traceFile(path, ios::binary | ios::trunc);
+    traceFile << traceJson();
+    traceFile.close();
+
+    return !traceFile.fail();
+}
+
+
+///helpers
+
+string jsonString(const string &text) {
+    ostringstream quoted;
+    quoted << '"';
+    for (size_t i = 0; i < text.length(); i++) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\') {
+            quoted << '\\' << c;
+        }
+        else if (c < 0x20) {
+            quoted << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec;
+        }
+        else {
+            quoted << c;
+        }
+    }
+    quoted << '"';
+
+    return quoted.str();
+}
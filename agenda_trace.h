@@ -0,0 +1,87 @@
+/**
+ *   @file: agenda_trace.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Scoped spans recorded on every thread and saved as a Chrome trace, for --trace.
+ * 
+ * The saved file opens in chrome://tracing or ui.perfetto.dev, with one row per thread. Until tracing
+ * starts, a span only checks a flag.
+ */
+
+#ifndef AGENDA_TRACE_H
+#define AGENDA_TRACE_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+class TraceSpan {
+    public:
+        /**
+         * @brief Construct a new TraceSpan object, starting a span if tracing started.
+         * 
+         * @param name what the span covers, which must outlive the trace
+         * @param detail shown with the span, like the command or the lines it covers
+         */
+        TraceSpan(const char *name, const string &detail = string());
+
+        /**
+         * @brief Destroy the TraceSpan object, recording the span.
+         */
+        ~TraceSpan();
+
+        /**
+         * Function: end
+         * @brief Records the span now instead of when it is destroyed, if it is still open.
+         */
+        void end();
+    private:
+        const char *name;  // what the span covers, NULL if tracing hadn't started or the span ended
+        string detail;     // shown with the span
+        double start;      // microseconds since tracing started
+
+        TraceSpan(const TraceSpan &);
+        TraceSpan &operator =(const TraceSpan &);
+};
+
+/**
+ * Function: startTrace
+ * @brief Starts recording spans, dropping any recorded before.
+ */
+void startTrace();
+
+/**
+ * Function: traceStarted
+ * @brief Tells whether spans are being recorded, so callers can skip building details nobody sees.
+ * 
+ * @return true once startTrace was called
+ */
+bool traceStarted();
+
+/**
+ * Function: saveTrace
+ * @brief Writes the spans recorded so far to a file in Chrome's trace event format.
+ * 
+ * @param path path of the trace file
+ * @return false if the file couldn't be written
+ */
+bool saveTrace(const string &path);
+
+/**
+ * Function: traceJson
+ * @brief Gets the spans recorded so far in Chrome's trace event format.
+ * 
+ * @return the trace as a JSON object
+ */
+string traceJson();
+
+/**
+ * Function: jsonString
+ * @brief Quotes a string for JSON, escaping quotes, backslashes and every control char.
+ * 
+ * @param text the string
+ * @return the quoted string
+ */
+string jsonString(const string &text);
+
+#endif
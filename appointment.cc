@@ -1,13 +1,22 @@
 #include <string>
+#include <string_view>
+#include <memory_resource>
+#include <charconv>
 #include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <iostream>
 #include "appointment.h"
 using namespace std;
 
 ///constructors
 
-Appointment::Appointment() {
-    title = "N/A";
+Appointment::Appointment() : Appointment(pmr::get_default_resource()) {
+}
+
+Appointment::Appointment(pmr::memory_resource *titleResource) : title("N/A", titleResource) {
+    titleKey = foldedHash(title);
     year = 1;
     month = 1;
     day = 1;
@@ -15,56 +24,54 @@ Appointment::Appointment() {
     duration = 1;
 }
 
-Appointment::Appointment(string appData) : Appointment() {
-    int indices[7];    // contains the start indices of each parameter, plus another index so the length of the last parameter can be determined
-    string params[6];  // contains each parameter from appData
+Appointment::Appointment(string_view appData, pmr::memory_resource *titleResource) : Appointment(titleResource) {
+    string_view params[6];  // contains each parameter from appData, viewed in place
 
-    // determine starting indices of each parameter
-    indices[0] = 0;    // first param starts at index 0
-    for (int i = 1; i < 6; i++) {
-        indices[i] = appData.find("|", indices[i - 1]) + 1;
-        if (indices[i] == 0) {
-            indices[i] = appData.length() + 1;
-        }
-    }
-    indices[6] = appData.length() + 1;
-
-    // parse appData into an array of parameters
-    for (int i = 0; i < 6; i++) {
-        // only add a param if the current index is within the string bounds
-        if (indices[i] < static_cast<int>(appData.length() + 1)) {
-            params[i] = stripSpaces(appData.substr(indices[i], (indices[i + 1] - 1 - indices[i])));
-        }
-        else {
-            break;
+    // split appData at its barlines; the last parameter runs to the end, barlines and all
+    size_t start = 0;  // index where the current parameter starts
+    for (int i = 0; i < 6 && start <= appData.length(); i++) {
+        size_t end = (i < 5) ? appData.find('|', start) : string_view::npos;
+        if (end == string_view::npos) {
+            end = appData.length();
         }
+        params[i] = trimSpaces(appData.substr(start, end - start));
+        start = end + 1;
     }
     
     // set each value based on its corresponding parameter if the parameter is valid
     // if the parameter is invalid, retain the default value
-    setTitle(params[0]);
+    title.assign(params[0].data(), params[0].length());
+    titleKey = foldedHash(title);
     if (isInt(params[1])) {
-        setYear(stoi(params[1]));
+        setYear(toInt(params[1]));
     }
     if (isInt(params[2])) {
-        setMonth(stoi(params[2]));
+        setMonth(toInt(params[2]));
     }
     if (isInt(params[3])) {
-        setDay(stoi(params[3]));
+        setDay(toInt(params[3]));
     }
     setTime(standardToMilitary(params[4]));
     if (isInt(params[5])) {
-        setDuration(stoi(params[5]));
+        setDuration(toInt(params[5]));
     }
 }
 
 
 ///getters
 
-string Appointment::getTitle() const {
+const pmr::string &Appointment::getTitle() const {
     return title;
 }
 
+uint32_t Appointment::getTitleKey() const {
+    return titleKey;
+}
+
+bool Appointment::matchesTitle(string_view other, uint32_t otherKey) const {
+    return titleKey == otherKey && equalsIgnoringCase(title, other);
+}
+
 int Appointment::getYear() const {
     return year;
 }
@@ -86,10 +93,18 @@ int Appointment::getDuration() const {
 }
 
 string Appointment::getDate() const {
-    string monthPadding = (month < 10) ? "0" : "";  // add a leading 0 if necessary so the month is always 2 digits
-    string dayPadding = (day < 10) ? "0" : "";      // add a leading 0 if necessary so the day is always 2 digits
+    string date;
+    appendDate(date);
+
+    return date;
+}
 
-    return to_string(year) + "-" + monthPadding + to_string(month) + "-" + dayPadding + to_string(day);
+void Appointment::appendDate(string &output) const {
+    appendNumber(year, output);
+    output += (month < 10) ? "-0" : "-";  // add a leading 0 if necessary so the month is always 2 digits
+    appendNumber(month, output);
+    output += (day < 10) ? "-0" : "-";    // add a leading 0 if necessary so the day is always 2 digits
+    appendNumber(day, output);
 }
 
 string Appointment::getStandardTime() const {
@@ -97,14 +112,48 @@ string Appointment::getStandardTime() const {
 }
 
 string Appointment::getAppointmentString() const {
-    return title + "|" + to_string(year) + "|" + to_string(month) + "|" + to_string(day) + "|" + getStandardTime() + "|" + to_string(duration);
+    string appointmentString;
+    appointmentString.reserve(title.length() + 32);  // room for the numbers, so the string grows once
+    appendAppointmentString(appointmentString);
+
+    return appointmentString;
+}
+
+void Appointment::appendAppointmentString(string &output) const {
+    output += title;
+    output += '|';
+    appendNumber(year, output);
+    output += '|';
+    appendNumber(month, output);
+    output += '|';
+    appendNumber(day, output);
+    output += '|';
+    appendStandardTime(time, output);
+    output += '|';
+    appendNumber(duration, output);
 }
 
 
 ///setters
 
-void Appointment::setTitle(string newTitle) {
-    title = stripSpaces(newTitle);
+void Appointment::setTitle(string_view newTitle) {
+    string_view trimmed = trimSpaces(newTitle);
+    title.assign(trimmed.data(), trimmed.length());
+    titleKey = foldedHash(title);
+}
+
+void Appointment::setTitle(pmr::string &&newTitle) {
+    // trimmed in place, so the move assignment can keep the storage when the resources match
+    string_view trimmed = trimSpaces(newTitle);
+    size_t leading = trimmed.data() - newTitle.data();
+    newTitle.erase(leading + trimmed.length());
+    newTitle.erase(0, leading);
+    title = move(newTitle);
+    titleKey = foldedHash(title);
+}
+
+void Appointment::setTitle(const char *newTitle) {
+    setTitle(string_view(newTitle));
 }
 
 void Appointment::setYear(int newYear) {
@@ -149,18 +198,16 @@ void Appointment::setDate(int newYear, int newMonth, int newDay) {
 ///helpers
 
 string Appointment::militaryToStandard(int time) const {
-    string meridiem;                                  // AM or PM
+    string standard;
+    appendStandardTime(time, standard);
+
+    return standard;
+}
+
+void Appointment::appendStandardTime(int time, string &output) const {
     int minute = time % 100;
-    string minutePadding = (minute < 10) ? "0" : "";  // add a leading 0 if necessary so the minute is always 2 digits
     int hour = (time - minute) / 100;
 
-    if (time >= 1200) {
-        meridiem = "PM";
-    }
-    else {
-        meridiem = "AM";
-    }
-
     if (hour >= 13) {      // handle 12-hour wraparound
         hour = hour - 12;
     }
@@ -168,12 +215,15 @@ string Appointment::militaryToStandard(int time) const {
         hour = 12;
     }
 
-    return to_string(hour) + ":" + minutePadding + to_string(minute) + meridiem;
+    appendNumber(hour, output);
+    output += (minute < 10) ? ":0" : ":";  // add a leading 0 if necessary so the minute is always 2 digits
+    appendNumber(minute, output);
+    output += (time >= 1200) ? "PM" : "AM";
 }
 
-int Appointment::standardToMilitary(string time) const {
-    string meridiemIndexSearches[4] = {"a", "A", "p", "P"};  // all possible first characters of the meridiem
-    int colonIndex = time.find(":");
+int Appointment::standardToMilitary(string_view time) const {
+    const char meridiemIndexSearches[4] = {'a', 'A', 'p', 'P'};  // all possible first characters of the meridiem
+    int colonIndex = time.find(':');
     int meridiemIndex = -1;
     
     // try searching for each first character of the meridiem
@@ -192,21 +242,21 @@ int Appointment::standardToMilitary(string time) const {
 
     // only convert if all parts of the time string were found
     if (colonIndex > 0 && meridiemIndex > 0) {
-        string hourString, minuteString;
-        hourString = time.substr(0, colonIndex);
-        minuteString = time.substr((colonIndex + 1), 2);
-
-        string meridiem = stringToUpper(time.substr(meridiemIndex, 2));
+        string_view hourString = time.substr(0, colonIndex);
+        string_view minuteString = time.substr((colonIndex + 1), 2);
+        string_view meridiem = time.substr(meridiemIndex, 2);
+        bool morning = meridiem.length() == 2 && toupper(meridiem[0]) == 'A' && toupper(meridiem[1]) == 'M';
+        bool evening = meridiem.length() == 2 && toupper(meridiem[0]) == 'P' && toupper(meridiem[1]) == 'M';
 
         // only convert if all parts of the time string were valid
-        if (isInt(hourString) && isInt(minuteString) && (meridiem == "AM" || meridiem == "PM")) {
-            hour = stoi(hourString);
-            minute = stoi(minuteString);
+        if (isInt(hourString) && isInt(minuteString) && (morning || evening)) {
+            hour = toInt(hourString);
+            minute = toInt(minuteString);
 
-            if (meridiem == "PM" && hour < 12) {       // handle 12-hour wraparound
+            if (evening && hour < 12) {          // handle 12-hour wraparound
                 hour += 12;
             }
-            else if(meridiem == "AM" && hour == 12) {  // handle special case for midnight - 1AM
+            else if(morning && hour == 12) {  // handle special case for midnight - 1AM
                 hour = 0;
             }
         }
@@ -216,13 +266,19 @@ int Appointment::standardToMilitary(string time) const {
     return ((hour * 100) + minute);
 }
 
-string Appointment::stripSpaces(string input) const {
+string Appointment::stripSpaces(string_view input) const {
+    string_view trimmed = trimSpaces(input);
+
+    return string(trimmed.data(), trimmed.length());
+}
+
+string_view Appointment::trimSpaces(string_view input) const {
     int leftIndex = 0;
     int rightIndex = input.length() - 1;
 
     // find beginning of string
     for (int i = 0; i <= rightIndex; i++) {
-        if (isspace(input.at(i))) {
+        if (isspace(input[i])) {
             leftIndex++;
         }
         else {
@@ -232,7 +288,7 @@ string Appointment::stripSpaces(string input) const {
 
     // find end of string
     for (int i = rightIndex; i >= leftIndex; i--) {
-        if (isspace(input.at(i))) {
+        if (isspace(input[i])) {
             rightIndex--;
         }
         else {
@@ -243,16 +299,62 @@ string Appointment::stripSpaces(string input) const {
     return input.substr(leftIndex, (rightIndex - leftIndex + 1));
 }
 
-string Appointment::stringToUpper(string input) const {
-    string output = "";
-    for (size_t i = 0; i < input.length(); i++) {
-        output += toupper(input.at(i));
-    }
+string Appointment::stringToUpper(string_view input) const {
+    string output(input);
+    foldCase(&output[0], output.length());
 
     return output;
 }
 
-bool Appointment::isInt(string input) const {
+void Appointment::foldCase(char *text, size_t length) {
+    for (size_t i = 0; i < length; i += 8) {
+        size_t count = min<size_t>(8, length - i);
+        uint64_t word = 0;
+        memcpy(&word, text + i, count);
+        word = foldWord(word);
+        memcpy(text + i, &word, count);
+    }
+}
+
+bool Appointment::equalsIgnoringCase(string_view first, string_view second) {
+    if (first.length() != second.length()) {
+        return false;
+    }
+
+    // the chars past the end of the shorter last chunk stay 0 in both words
+    for (size_t i = 0; i < first.length(); i += 8) {
+        size_t count = min<size_t>(8, first.length() - i);
+        uint64_t firstWord = 0;
+        uint64_t secondWord = 0;
+        memcpy(&firstWord, first.data() + i, count);
+        memcpy(&secondWord, second.data() + i, count);
+        if (foldWord(firstWord) != foldWord(secondWord)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t Appointment::foldedHash(string_view input) {
+    uint32_t hash = 2166136261U;  // 32-bit FNV-1a
+    unsigned char folded[8];
+    for (size_t i = 0; i < input.length(); i += 8) {
+        size_t count = min<size_t>(8, input.length() - i);
+        uint64_t word = 0;
+        memcpy(&word, input.data() + i, count);
+        word = foldWord(word);
+        memcpy(folded, &word, count);
+        for (size_t j = 0; j < count; j++) {
+            hash ^= folded[j];
+            hash *= 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+bool Appointment::isInt(string_view input) const {
     // scan through each char of the string
     for (size_t i = 0; i < input.length(); i++) {
         if (isdigit(input[i])) {       // if the current char is a digit, the string contains an int
@@ -266,6 +368,38 @@ bool Appointment::isInt(string input) const {
     return false;  // runs if the function never finds a digit or a non-space character
 }
 
+int Appointment::toInt(string_view input) {
+    size_t first = 0;
+    while (first < input.length() && isspace(input[first])) {
+        first++;
+    }
+
+    int value = 0;
+    if (from_chars(input.data() + first, input.data() + input.length(), value).ec != errc()) {
+        return -1;
+    }
+
+    return value;
+}
+
+uint64_t Appointment::foldWord(uint64_t word) {
+    const uint64_t ones = 0x0101010101010101ULL;  // 1 in every byte
+
+    // a byte is a lowercase letter if it is at least 'a', at most 'z' and ASCII; with the top bit of every byte
+    // cleared first, adding to a byte can't carry into the next one, so each sum's top bit answers for its byte
+    uint64_t low = word & (0x7f * ones);
+    uint64_t fromA = low + (0x80 - 'a') * ones;
+    uint64_t pastZ = low + (0x80 - 'z' - 1) * ones;
+    uint64_t lowercase = fromA & ~pastZ & ~word & (0x80 * ones);
+
+    return word - (lowercase >> 2);  // 0x80 >> 2 is the 0x20 between a lowercase letter and its uppercase one
+}
+
+void Appointment::appendNumber(int number, string &output) {
+    char digits[12];  // enough for any int with its sign
+    output.append(digits, to_chars(digits, digits + sizeof(digits), number).ptr - digits);
+}
+
 /// friends
 
 bool operator ==(const Appointment &first, const Appointment &second) {
@@ -290,4 +424,15 @@ bool operator ==(const Appointment &first, const Appointment &second) {
     else {
         return true;
     }
-}
\ No newline at end of file
+}
+
+size_t hash<Appointment>::operator()(const Appointment &appointment) const {
+    // combine the same fields operator == compares, so equal appointments always hash the same
+    size_t hashed = hash<pmr::string>()(appointment.title);
+    int fields[5] = {appointment.year, appointment.month, appointment.day, appointment.time, appointment.duration};
+    for (int i = 0; i < 5; i++) {
+        hashed ^= hash<int>()(fields[i]) + 0x9e3779b97f4a7c15ULL + (hashed << 6) + (hashed >> 2);
+    }
+
+    return hashed;
+}
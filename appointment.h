@@ -1,7 +1,25 @@
 #ifndef APPOINTMENT_H
 #define APPOINTMENT_H
+
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <functional>
+#include <cstdint>
 using namespace std;
 
+class Appointment;
+
+namespace std {
+    /**
+     * @brief Hashes an Appointment object consistently with operator ==, so appointments can be used in unordered containers.
+     */
+    template <>
+    struct hash<Appointment> {
+        size_t operator()(const Appointment &appointment) const;
+    };
+}
+
 class Appointment {
     public:
         /** Default constructor
@@ -10,20 +28,47 @@ class Appointment {
          * Initializes title as "N/A", year as 1, month as 1, day as 1, time as 0, and duration as 1.
          */
         Appointment();
+        /**
+         * @brief Construct a new Appointment object with the same defaults, whose title is allocated from titleResource.
+         * 
+         * @param titleResource the memory resource the title is allocated from, which must outlive the appointment
+         */
+        explicit Appointment(pmr::memory_resource *titleResource);
         /**
          * @brief Construct a new Appointment object from appData.
          * 
          * @param appData the string containing all the appointment details, separated by barlines
+         * @param titleResource the memory resource the title is allocated from, which must outlive the appointment
          */
-        Appointment(string appData);
+        Appointment(string_view appData, pmr::memory_resource *titleResource = pmr::get_default_resource());
 
         /**
          * Function: getTitle
          * @brief Gets the title of the appointment.
          * 
-         * @return title of the appointment
+         * @return title of the appointment, valid until the title changes
+         */
+        const pmr::string &getTitle() const;
+
+        /**
+         * Function: getTitleKey
+         * @brief Gets the hash of the title with its letters folded to uppercase, computed whenever the title is set.
+         * 
+         * @return foldedHash of the title, the same for titles that only differ in case
          */
-        string getTitle() const;
+        uint32_t getTitleKey() const;
+
+        /**
+         * Function: matchesTitle
+         * @brief Checks if the title equals another title, ignoring the case of ASCII letters.
+         * 
+         * The keys are compared first, so only titles that match or collide with the other title get compared.
+         * 
+         * @param other the other title
+         * @param otherKey foldedHash of the other title, computed once by callers checking many appointments
+         * @return true if the titles only differ in case
+         */
+        bool matchesTitle(string_view other, uint32_t otherKey) const;
 
         /**
          * Function: getYear
@@ -73,6 +118,14 @@ class Appointment {
          */
         string getDate() const;
 
+        /**
+         * Function: appendDate
+         * @brief Adds the full date of the appointment in YYYY-MM-DD format to the end of a string.
+         * 
+         * @param output the string to add to
+         */
+        void appendDate(string &output) const;
+
         /**
          * Function: getStandardTime
          * @brief Gets the time of the appointment in standard format.
@@ -84,11 +137,29 @@ class Appointment {
 
         /**
          * Function: setTitle
-         * @brief Sets the title of the appointment.
+         * @brief Sets the title of the appointment, allocated from the same memory resource as before.
          * 
          * @param newTitle the new title
          */
-        void setTitle(string newTitle);
+        void setTitle(string_view newTitle);
+
+        /**
+         * Function: setTitle
+         * @brief Sets the title of the appointment, taking over the storage of a title from the same memory resource.
+         * 
+         * A title from another resource is copied into this one, like the string_view overload does.
+         * 
+         * @param newTitle the new title, left empty or unspecified
+         */
+        void setTitle(pmr::string &&newTitle);
+
+        /**
+         * Function: setTitle
+         * @brief Sets the title of the appointment from a C string, which would convert to either of the other overloads.
+         * 
+         * @param newTitle the new title
+         */
+        void setTitle(const char *newTitle);
 
         /**
          * Function: setYear
@@ -150,6 +221,15 @@ class Appointment {
          */
         string militaryToStandard(int time) const;
 
+        /**
+         * Function: appendStandardTime
+         * @brief Adds a time converted from military to standard format to the end of a string.
+         * 
+         * @param time the time in military format
+         * @param output the string to add to
+         */
+        void appendStandardTime(int time, string &output) const;
+
         /**
          * Function: standardToMilitary
          * @brief converts a time from standard to military format.
@@ -157,7 +237,7 @@ class Appointment {
          * @param time the time in standard format
          * @return the time in military format
          */
-        int standardToMilitary(string time) const;
+        int standardToMilitary(string_view time) const;
 
         /**
          * Function: getAppointmentString
@@ -167,6 +247,14 @@ class Appointment {
          */
         string getAppointmentString() const;
 
+        /**
+         * Function: appendAppointmentString
+         * @brief Adds the string with all the appointment data to the end of a string, so a buffer can be reused across appointments.
+         * 
+         * @param output the string to add to
+         */
+        void appendAppointmentString(string &output) const;
+
 
         /**
          *  Function: stripSpaces
@@ -184,7 +272,16 @@ class Appointment {
          *  @param input the string to be stripped
          *  @return the string with no leading or trailing spaces
          */
-        string stripSpaces(string input) const;
+        string stripSpaces(string_view input) const;
+
+        /**
+         *  Function: trimSpaces
+         *  @brief Gets the part of a string between its leading and trailing spaces, without copying it.
+         * 
+         *  @param input the string to be trimmed
+         *  @return view of input with no leading or trailing spaces
+         */
+        string_view trimSpaces(string_view input) const;
         
         /**
          *  Function: stringToUpper
@@ -193,7 +290,35 @@ class Appointment {
          *  @param input the string to be converted
          *  @return the string in uppercase
          */
-        string stringToUpper(string input) const;
+        string stringToUpper(string_view input) const;
+
+        /**
+         *  Function: foldCase
+         *  @brief Converts the ASCII letters of a string to uppercase in place, eight chars at a time.
+         * 
+         *  @param text the chars to be converted
+         *  @param length number of chars
+         */
+        static void foldCase(char *text, size_t length);
+
+        /**
+         *  Function: equalsIgnoringCase
+         *  @brief Compares two strings, ignoring the case of ASCII letters, eight chars at a time.
+         * 
+         *  @param first the first string
+         *  @param second the second string
+         *  @return true if the strings only differ in case
+         */
+        static bool equalsIgnoringCase(string_view first, string_view second);
+
+        /**
+         *  Function: foldedHash
+         *  @brief Hashes a string with its ASCII letters converted to uppercase.
+         * 
+         *  @param input the string to be hashed
+         *  @return 32-bit FNV-1a hash of the uppercased string
+         */
+        static uint32_t foldedHash(string_view input);
 
         /**
          * Function: isInt
@@ -201,7 +326,16 @@ class Appointment {
          * 
          * @return true if the string contains a valid int
          */
-        bool isInt(string input) const;
+        bool isInt(string_view input) const;
+
+        /**
+         * Function: toInt
+         * @brief Reads the int at the start of a string, after any leading spaces, like stoi.
+         * 
+         * @param input a string isInt accepts
+         * @return the int, or -1 if it doesn't fit in an int
+         */
+        static int toInt(string_view input);
 
 
         /**
@@ -213,13 +347,34 @@ class Appointment {
          * @return true if the objects contain all the same values
          */
         friend bool operator ==(const Appointment &first, const Appointment &second);
+        friend struct hash<Appointment>;
     private:
-        string title;  // the title of the appointment
+        /**
+         * Function: appendNumber
+         * @brief Adds a number in decimal to the end of a string.
+         * 
+         * @param number the number
+         * @param output the string to add to
+         */
+        static void appendNumber(int number, string &output);
+
+        /**
+         * Function: foldWord
+         * @brief Converts the ASCII letters among eight chars packed in a word to uppercase.
+         * 
+         * @param word the chars
+         * @return the chars with every lowercase ASCII letter converted
+         */
+        static uint64_t foldWord(uint64_t word);
+
+
+        pmr::string title;  // the title of the appointment; a copy allocates its title from the default resource, a move keeps this one
         int year;      // the year of the appointment's starting date
         int month;     // the month of the appointment's starting date
         int day;       // the day of the appointment's starting date
         int time;      // the starting time of the appointment
         int duration;  // the duration of the appointment
+        uint32_t titleKey;  // foldedHash of the title, set along with it
 };
 
 #endif
\ No newline at end of file
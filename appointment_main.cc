@@ -9,76 +9,585 @@
 #include <iomanip>
 #include <cstdlib>
 #include <fstream>
+#include <string_view>
 #include <vector>
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <iterator>
+#include <memory>
+#include <map>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "appointment.h"
+#include "agenda_index.h"
+#include "agenda_log.h"
+#include "agenda_tombstones.h"
+#include "agenda_dedupe.h"
+#include "agenda_alloc_stats.h"
+#include "agenda_command.h"
+#include "agenda_arena.h"
+#include "agenda_load.h"
+#include "agenda_stats.h"
+#include "agenda_trace.h"
+#include "agenda_lock.h"
+#include "agenda_server.h"
+#include "agenda_shards.h"
+#include "agenda_snapshots.h"
+#include "interval_tree.h"
+#include "schedule.h"
+#include "trigram_index.h"
 using namespace std;
 
+struct Session {
+    AgendaSnapshots versions;   // the whole agenda with the log replayed, once resident
+    bool resident = false;      // whether versions holds the agenda, so commands work on it instead of the files
+    bool changed = false;       // whether versions changed since it was loaded
+    bool writeThrough = false;  // whether changes also go to the files as they are made, as they do without a session
+};
+
+/**
+ * Function: runCommand
+ * @brief Runs one command given as command line arguments.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, starting with the program name
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ * @param session the agenda kept in memory between commands, if any
+ * @param out stream that receives the command's output
+ */
+void runCommand(int argc, char const *argv[], AgendaLog &log, Tombstones &tombstones, Session &session, ostream &out);
+
+/**
+ * Function: runBatch
+ * @brief Runs every command in a script against an agenda loaded once, then writes the appointment file once
+ * if any command changed it.
+ * 
+ * Each line of the script holds one command's arguments, with quotes around arguments that contain spaces.
+ * Blank lines and lines starting with # are skipped.
+ * 
+ * @param script the script
+ * @param programName the name the program was run with
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void runBatch(istream &script, const string &programName, AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: runServer
+ * @brief Keeps the agenda loaded and serves commands over a Unix domain socket until SIGINT or SIGTERM.
+ * 
+ * Changes are applied in memory and appended to the log as they are made, so they survive the server.
+ * 
+ * @param programName the name the program was run with
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void runServer(const string &programName, AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: runLine
+ * @brief Runs one line of a batch script or one request sent to the server.
+ * 
+ * @param line the command's arguments; blank lines and lines starting with # are skipped
+ * @param programName the name the program was run with
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ * @param session the agenda kept in memory between commands
+ * @param out stream that receives the command's output
+ */
+void runLine(const string &line, const string &programName, AgendaLog &log, Tombstones &tombstones, Session &session, ostream &out);
+
 /**
  * Function: isInt
  * @brief Checks if a string contains a valid int.
  * 
  * @return true if the string contains a valid int
  */
-bool isInt(string input);
+bool isInt(string_view input);
+
+/**
+ * Function: parseNumber
+ * @brief Reads a string that holds nothing but digits as an int.
+ * 
+ * @param input the string
+ * @param value receives the int
+ * @return true if the string holds a non-negative int
+ */
+bool parseNumber(string_view input, int &value);
+
+/**
+ * Function: parseDate
+ * @brief Reads a date in YYYY-MM-DD format.
+ * 
+ * @param input the date string
+ * @param year receives the year
+ * @param month receives the month
+ * @param day receives the day
+ * @return true if the string holds a valid date
+ */
+bool parseDate(const string &input, int &year, int &month, int &day);
+
+/**
+ * Function: formatMinute
+ * @brief Formats an absolute minute as a date and standard time.
+ * 
+ * @param minute minutes since 1970-01-01 12:00AM
+ * @return the minute in YYYY-MM-DD|H:MMAM format
+ */
+string formatMinute(int64_t minute);
+
+/**
+ * Function: extractPaging
+ * @brief Removes the --offset and --limit options from the arguments.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, compacted in place
+ * @param pageOffset receives the number of results to skip (0 if not given)
+ * @param pageLimit receives the maximum number of results to print (SIZE_MAX if not given)
+ * @return the number of arguments left, or -1 if an option value is invalid
+ */
+int extractPaging(int argc, char const *argv[], size_t &pageOffset, size_t &pageLimit);
+
+/**
+ * Function: extractStats
+ * @brief Removes the --stats and --stats=json options from the arguments, enabling stats if either is given.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, compacted in place
+ * @return the number of arguments left
+ */
+int extractStats(int argc, char const *argv[]);
+
+/**
+ * Function: extractTrace
+ * @brief Removes the --trace option from the arguments, starting a trace if it is given.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, compacted in place
+ * @param tracePath receives the path the trace is saved to, empty if not given
+ * @return the number of arguments left, or -1 if the path is missing
+ */
+int extractTrace(int argc, char const *argv[], string &tracePath);
+
+/**
+ * Function: extractArena
+ * @brief Removes the --arena option from the arguments.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, compacted in place
+ * @param useArena receives whether the option was given
+ * @return the number of arguments left
+ */
+int extractArena(int argc, char const *argv[], bool &useArena);
+
+/**
+ * Function: readAt
+ * @brief Reads the appointments on the given lines of the appointment file.
+ * 
+ * @param offsets file offsets of the lines to read
+ * @param appointments vector that receives the appointments
+ */
+void readAt(const vector<uint64_t> &offsets, vector<Appointment> &appointments);
+
+/**
+ * Function: readLive
+ * @brief Reads the appointments on the given records of the appointment file, skipping the deleted ones.
+ * 
+ * @param records record numbers to read
+ * @param offsets file offsets of the records
+ * @param tombstones the records of the appointment file that were deleted
+ * @param appointments vector that receives the appointments
+ */
+void readLive(const vector<uint32_t> &records, const vector<uint64_t> &offsets, const Tombstones &tombstones, vector<Appointment> &appointments);
+
+/**
+ * Function: formatBucket
+ * @brief Formats the key of a day, week or month bucket.
+ * 
+ * @param key the key returned by bucketKey
+ * @param span BUCKET_DAY, BUCKET_WEEK or BUCKET_MONTH
+ * @return the bucket in YYYY-MM-DD, YYYY-Www or YYYY-MM format
+ */
+string formatBucket(uint32_t key, int span);
+
+/**
+ * Function: printPage
+ * @brief Prints one page of appointments.
+ * 
+ * @param out stream to print to
+ * @param appointments the appointments to print from
+ * @param pageOffset the number of appointments to skip
+ * @param pageLimit the maximum number of appointments to print
+ */
+void printPage(ostream &out, const vector<Appointment> &appointments, size_t pageOffset, size_t pageLimit);
+
+/**
+ * Function: loadAppointments
+ * @brief Loads all the appointments from the appointment file, indexing each one by its line offset.
+ * 
+ * @param appointments vector that receives all the appointments that weren't deleted
+ * @param index index that receives one record per appointment, saved if the index file was stale
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void loadAppointments(vector<Appointment> &appointments, AgendaIndex &index, const Tombstones &tombstones);
+
+/**
+ * Function: loadAgenda
+ * @brief Gets the whole agenda, from memory if it is resident or else from the appointment file with the log replayed.
+ * 
+ * @param snapshot the resident version of the agenda, NULL if there is none
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ * @param appointments vector that receives all the appointments
+ * @param index index that receives one record per line of the appointment file, if it is read
+ */
+void loadAgenda(const Snapshot *snapshot, const AgendaLog &log, const Tombstones &tombstones, vector<Appointment> &appointments, AgendaIndex &index);
+
+/**
+ * Function: loadIntervals
+ * @brief Builds one interval per appointment, straight from the index when the log is empty so no line has to be parsed.
+ * 
+ * @param snapshot the resident version of the agenda, used instead of the files unless it is NULL
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ * @param intervals vector that receives the intervals
+ * @param appointments vector that receives all the appointments if the index couldn't be used
+ * @param index index that receives the index of the appointment file
+ * @return true if the intervals came from the index, whose record numbers are then the interval ids
+ */
+bool loadIntervals(const Snapshot *snapshot, const AgendaLog &log, const Tombstones &tombstones, vector<Interval> &intervals, vector<Appointment> &appointments, AgendaIndex &index);
+
+/**
+ * Function: fetchAppointments
+ * @brief Gets the appointments behind the ids of intervals built by loadIntervals.
+ * 
+ * @param ids the interval ids
+ * @param fromIndex what loadIntervals returned
+ * @param index the index filled in by loadIntervals
+ * @param appointments the appointments filled in by loadIntervals
+ * @param matches vector that receives the appointments, in the order of ids
+ */
+void fetchAppointments(const vector<size_t> &ids, bool fromIndex, const AgendaIndex &index, const vector<Appointment> &appointments, vector<Appointment> &matches);
 
 /**
  * Function: writeAppointments
- * @brief Writes all the appointments to the appointment file.
+ * @brief Writes all the appointments to the appointment file and rebuilds its index.
+ * 
+ * The appointments have to take in every logged change, since swapping the new file in ends the log.
  * 
  * @param appointments vector containing all the appointments
  */
-void writeAppointments(const vector<Appointment> appointments);
+void writeAppointments(const vector<Appointment> &appointments);
+
+/**
+ * Function: deleteAppointments
+ * @brief Logs a delete operation and marks the records of the appointment file that match it as dead.
+ * 
+ * A stale bitmap is rebuilt from the deletes in the log first.
+ * 
+ * @param type LOG_DELETE_TITLE, LOG_DELETE_TITLE_IGNORING_CASE or LOG_DELETE_TIME
+ * @param data the title or time to delete
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void deleteAppointments(char type, const string &data, AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: markMatches
+ * @brief Marks the live records of the appointment file that match a delete operation as dead.
+ * 
+ * @param type LOG_DELETE_TITLE, LOG_DELETE_TITLE_IGNORING_CASE or LOG_DELETE_TIME
+ * @param data the title or time to delete
+ * @param index the index of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ * @return true if any record was marked
+ */
+bool markMatches(char type, const string &data, const AgendaIndex &index, Tombstones &tombstones);
+
+/**
+ * Function: compactAgenda
+ * @brief Rewrites the appointment file once the log grows past LOG_COMPACT_BYTES or the share of
+ * dead records passes DEAD_COMPACT_FRACTION.
+ * 
+ * @param snapshot the resident version of the agenda, written out instead of reloading the files unless it is NULL
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void compactAgenda(const Snapshot *snapshot, AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: changeAgenda
+ * @brief Adds or deletes appointments, in the session if it is resident and in the files if it isn't or writes through.
+ * 
+ * @param op the change, as it would be logged
+ * @param session the agenda kept in memory between commands
+ * @param log the log of the appointment file
+ * @param tombstones the records of the appointment file that were deleted
+ */
+void changeAgenda(const LogOp &op, Session &session, AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: changesAgenda
+ * @brief Tells whether a command can change the agenda files, so it has to hold the lock alone.
+ * 
+ * @param argFlag the command's first argument
+ * @return true for commands that add or delete appointments, batch scripts and the server
+ */
+bool changesAgenda(const string &argFlag);
+
+/**
+ * Function: runSharded
+ * @brief Runs one command against an agenda split into shards, opening only the shards it needs.
+ * 
+ * An added appointment goes to the shard of its month, and deletes run on each shard in turn, so only
+ * the shards they change get rewritten. Other commands run on the shards loaded into memory, which are
+ * only the months in range when the command takes dates.
+ * 
+ * @param argc number of arguments
+ * @param argv the arguments, starting with the program name
+ * @param log the log of the agenda file, which stays empty while the agenda is sharded
+ * @param tombstones the records of the agenda file that were deleted, which stay empty too
+ */
+void runSharded(int argc, char const *argv[], AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: runOnShard
+ * @brief Runs one command straight on the files of one shard.
+ * 
+ * @param path path of the shard's agenda file
+ * @param argc number of arguments
+ * @param argv the arguments, starting with the program name
+ * @return the command's output
+ */
+string runOnShard(const string &path, int argc, char const *argv[]);
+
+/**
+ * Function: loadShards
+ * @brief Loads the appointments of some shards with their logs replayed, one shard after another.
+ * 
+ * @param paths paths of the shards' agenda files
+ * @param appointments vector that receives the appointments
+ */
+void loadShards(const vector<string> &paths, vector<Appointment> &appointments);
+
+/**
+ * Function: writeShards
+ * @brief Writes an agenda as shards, one per year and month, keeping the order of the appointments in each.
+ * 
+ * @param appointments the whole agenda
+ * @param replaced paths of the shards being replaced; those left without appointments are removed
+ */
+void writeShards(const vector<Appointment> &appointments, const vector<string> &replaced);
+
+/**
+ * Function: shardAgenda
+ * @brief Splits the agenda file into shards and leaves it empty.
+ * 
+ * @param log the log of the agenda file
+ * @param tombstones the records of the agenda file that were deleted
+ */
+void shardAgenda(AgendaLog &log, Tombstones &tombstones);
+
+/**
+ * Function: unshardAgenda
+ * @brief Joins the shards back into the agenda file, in month order, and removes them.
+ * 
+ * @param log the log of the agenda file
+ * @param tombstones the records of the agenda file that were deleted
+ */
+void unshardAgenda(AgendaLog &log, Tombstones &tombstones);
 
 const string AGENDA_FILE_NAME = "agenda.txt";
+const string SOCKET_FILE_NAME = AGENDA_FILE_NAME + ".sock";  // where the server listens
+string agendaPath = AGENDA_FILE_NAME;  // the agenda file commands work on, which is one of its shards while a sharded command runs
+AgendaArena *loadArena = NULL;  // where the titles of loaded agendas are allocated, if --arena was given
 
 
 int main(int argc, char const *argv[]) {
-    vector<string> appointmentStrings;  // contains all the appointment strings from the appointment file
-    vector<Appointment> appointments;   // contains all the appointments created from appointmentStrings
+    AgendaLog log(AGENDA_FILE_NAME);    // mutations not yet written to the appointment file
+    Tombstones tombstones(AGENDA_FILE_NAME);  // deleted records still in the appointment file
+    string tracePath;  // where the trace goes, if one is taken
+    bool useArena;     // whether loaded titles come from an arena freed once the command ends
+    AgendaArena arena;
+    argc = extractStats(argc, argv);
+    argc = extractArena(argc, argv, useArena);
+    argc = extractTrace(argc, argv, tracePath);
+    if (argc < 0) {
+        cout << "No trace file given." << endl;
+        exit(0);
+    }
+    // a server would keep taking blocks for as long as it runs, since an arena gives nothing back until it is destroyed
+    if (useArena && !(argc >= 2 && string(argv[1]) == "-server")) {
+        loadArena = &arena;
+    }
+    // a server's phases would add up over every request it answers, with no one command to report them for
+    if (statsEnabled() && argc >= 2 && string(argv[1]) == "-server") {
+        cout << "--stats isn't supported with -server." << endl;
+        exit(0);
+    }
 
-    ifstream appointmentFile;           // file with each appointment string on a separate line
-    string lineIn;                      // holds a line from the appointment file
+    if (argc >= 2 && string(argv[1]) == "-client") {
+        // send the rest of the arguments to a running server and print its output
+        // a request is one line, so an argument can't hold a newline
+        string line;
+        for (int i = 2; i < argc; i++) {
+            if (string(argv[i]).find('\n') != string::npos) {
+                cout << "Arguments can't contain newlines." << endl;
+                return 0;
+            }
+            line += (i > 2 ? " " : "") + quoteArgument(argv[i]);
+        }
 
-    // read appointments file
-    appointmentFile.open(AGENDA_FILE_NAME);
+        AgendaClient client;
+        string response;
+        if (!client.connectTo(SOCKET_FILE_NAME) || !client.request(line, response)) {
+            cout << "Failed to reach server." << endl;
+        }
+        cout << response;
+        return 0;
+    }
+
+    // make sure the appointments file exists before running any command
+    PhaseTimer opening(STATS_OPEN);
+    ifstream appointmentFile(AGENDA_FILE_NAME);
     if (appointmentFile.fail()) {
         cout << "Failed to open file." << endl;
         exit(0);
     }
+    appointmentFile.close();
 
-    // load appointment strings line by line
-    while (getline(appointmentFile, lineIn)) {
-        appointmentStrings.push_back(lineIn);
+    // readers share the files, but a change from load to save runs alone, so no process saves over another's change
+    AgendaLock agendaLock(AGENDA_FILE_NAME);
+    bool exclusive = argc >= 2 && changesAgenda(argv[1]);
+    if (!agendaLock.lock(exclusive, false)) {
+        AgendaClient probe;
+        if (probe.connectTo(SOCKET_FILE_NAME)) {
+            cout << "Agenda is held by a server, use -client." << endl;  // the server keeps the lock until it stops
+            exit(0);
+        }
+        if (!agendaLock.lock(exclusive, true)) {
+            cout << "Failed to lock file." << endl;
+            exit(0);
+        }
     }
-    appointmentFile.close();
+    log.read();
+    tombstones.read();
+    opening.stop();
 
-    // load appointments from strings
-    for (size_t i = 0; i < appointmentStrings.size(); i++) {
-        Appointment newAppointment(appointmentStrings[i]);
+    // a log holds changes to the agenda file as it was when the log started, which can't be told apart from an edit since
+    string stalePath = log.isStale() ? AGENDA_FILE_NAME : findStaleShard(AGENDA_FILE_NAME);
+    if (!stalePath.empty()) {
+        cout << stalePath << " changed since its log was written; restore it, or remove " << AgendaLog::fileName(stalePath) << " to drop the logged changes." << endl;
+        exit(0);
+    }
+    PhaseTimer executing(STATS_EXECUTE);  // the phases below take their share out of it
+    TraceSpan commandSpan("command", argc >= 2 ? argv[1] : "");
 
-        // only load if the line contains non-whitespace chars
-        if (!newAppointment.stripSpaces(appointmentStrings[i]).empty()) {
-            appointments.push_back(newAppointment);
+    if (argc >= 2 && string(argv[1]) == "-b") {
+        // run every command in the script specified by the next argument, or in standard input for "-"
+        if (argc >= 3) {  // check if next argument exists
+            if (string(argv[2]) == "-") {
+                runBatch(cin, argv[0], log, tombstones);
+            }
+            else {
+                ifstream scriptFile(argv[2]);
+                if (scriptFile.fail()) {
+                    cout << "Failed to open script." << endl;
+                }
+                else {
+                    runBatch(scriptFile, argv[0], log, tombstones);
+                }
+            }
+        }
+        else {
+            cout << "No script given." << endl;
         }
     }
+    else if (argc >= 2 && string(argv[1]) == "-server") {
+        if (isSharded(AGENDA_FILE_NAME)) {
+            cout << "Server can't run on a sharded agenda." << endl;
+        }
+        else {
+            runServer(argv[0], log, tombstones);
+        }
+    }
+    else if (argc >= 2 && string(argv[1]) == "-shard") {
+        // split the agenda into one file per year and month
+        if (isSharded(AGENDA_FILE_NAME)) {
+            cout << "Agenda is already sharded." << endl;
+        }
+        else {
+            shardAgenda(log, tombstones);
+        }
+    }
+    else if (argc >= 2 && string(argv[1]) == "-unshard") {
+        // join the shards back into one agenda file
+        if (!isSharded(AGENDA_FILE_NAME)) {
+            cout << "Agenda isn't sharded." << endl;
+        }
+        else {
+            unshardAgenda(log, tombstones);
+        }
+    }
+    else if (isSharded(AGENDA_FILE_NAME)) {
+        runSharded(argc, argv, log, tombstones);
+    }
+    else {
+        Session session;  // nothing resident, so the command works straight on the files
+        runCommand(argc, argv, log, tombstones, session, cout);
+    }
+    reportAllocations(cerr, argc >= 2 ? argv[1] : "");
+    executing.stop();
+    if (statsEnabled()) {
+        reportStats(cerr, argc >= 2 ? argv[1] : "");
+    }
+    commandSpan.end();
+    if (!tracePath.empty() && !saveTrace(tracePath)) {
+        cout << "Failed to write trace." << endl;
+    }
+
+    return 0;
+}// main
+
+void runCommand(int argc, char const *argv[], AgendaLog &log, Tombstones &tombstones, Session &session, ostream &out) {
+    vector<Appointment> appointments;   // contains all the appointments from the appointment file
+    AgendaIndex index;                  // sidecar index of the appointment file
+    size_t pageOffset, pageLimit;       // which results -ps and -p print
+    shared_ptr<const Snapshot> snapshot = session.resident ? session.versions.current() : nullptr;  // the version this command reads
+    AllocationScope querying(ALLOC_QUERY);  // unless a narrower phase takes over
 
     // parse arguments
-    if (argc >= 2) {
+    argc = extractPaging(argc, argv, pageOffset, pageLimit);
+    if (argc < 0) {
+        out << "Invalid page." << endl;
+    }
+    else if (argc >= 2) {
         string argFlag = argv[1];
         if (argFlag == "-ps") {
-            // print daily schedule sorted by starting time
-            size_t originalSize = appointments.size();
-            for (size_t i = 0; i < originalSize; i++) {
-                int minIndex = 0;
-                int min = appointments[minIndex].getTime();
-                for (size_t j = 0; j < appointments.size(); j++) {
-                    if (appointments[j].getTime() < min) {
-                        minIndex = j;
-                        min = appointments[minIndex].getTime();
-                    }
-                }
-                cout << appointments[minIndex].getAppointmentString() << endl;
-                appointments.erase(appointments.begin() + minIndex);
+            // print daily schedule sorted by starting time, ties kept in file order
+            vector<uint32_t> records;  // record numbers of the page
+            vector<uint64_t> offsets;  // file offsets of the page
+            bool unchanged = !snapshot && log.coveredBy(tombstones) && tombstones.deadCount() == 0;  // whether the appointment file is the whole agenda
+
+            // a page can be read straight from the index, but the whole schedule is faster to read in one pass
+            if (snapshot) {
+                snapshot->page(0, TIME_BUCKETS, pageOffset, pageLimit, appointments);
+                printPage(out, appointments, 0, SIZE_MAX);
+            }
+            else if (pageLimit != SIZE_MAX && unchanged && AgendaIndex::lookupTimes(agendaPath, 0, TIME_BUCKETS, pageOffset, pageLimit, records, offsets)) {
+                readAt(offsets, appointments);
+                printPage(out, appointments, 0, SIZE_MAX);
+            }
+            else {
+                // load everything (which also rebuilds the index if it is stale)
+                loadAgenda(snapshot.get(), log, tombstones, appointments, index);
+                TraceSpan sorting("sort");
+                stable_sort(appointments.begin(), appointments.end(), [](const Appointment &first, const Appointment &second) {
+                    return first.getTime() < second.getTime();
+                });
+                printPage(out, appointments, pageOffset, pageLimit);
             }
         }
         else if (argFlag == "-p") {
@@ -86,87 +595,432 @@ int main(int argc, char const *argv[]) {
             if (argc >= 3) {  // check if next argument exists
                 if (isInt(argv[2])) {  // check if next argument contains an int
                     int time = stoi(argv[2]);
+                    vector<uint32_t> records;  // record numbers of the matches in the appointment file
+                    vector<uint64_t> offsets;  // file offsets of the matches in the appointment file
+                    bool unchanged = !snapshot && log.coveredBy(tombstones) && tombstones.deadCount() == 0;  // whether the appointment file is the whole agenda
 
-                    // print all matches
-                    for (size_t i = 0; i < appointments.size(); i++) {
-                        if (appointments[i].getTime() == time) {
-                            cout << appointments[i].getAppointmentString() << endl;
+                    if (snapshot) {
+                        snapshot->page(time, time + 1, pageOffset, pageLimit, appointments);
+                        printPage(out, appointments, 0, SIZE_MAX);
+                    }
+                    else if (unchanged && AgendaIndex::lookupTimes(agendaPath, time, time + 1, pageOffset, pageLimit, records, offsets)) {
+                        // read only the lines on the page
+                        readAt(offsets, appointments);
+                        printPage(out, appointments, 0, SIZE_MAX);
+                    }
+                    else {
+                        // read the matches in the appointment file, or scan everything if the index is stale;
+                        // the log can add or delete matches, so page after replaying it
+                        if (AgendaIndex::lookupTimes(agendaPath, time, time + 1, 0, SIZE_MAX, records, offsets)) {
+                            readLive(records, offsets, tombstones, appointments);
+                            log.replay(appointments);
                         }
+                        else {
+                            loadAgenda(snapshot.get(), log, tombstones, appointments, index);
+                        }
+                        appointments.erase(remove_if(appointments.begin(), appointments.end(), [time](const Appointment &appointment) {
+                            return appointment.getTime() != time;
+                        }), appointments.end());
+                        printPage(out, appointments, pageOffset, pageLimit);
                     }
                 }
                 else {
-                    cout << "Invalid time." << endl;
+                    out << "Invalid time." << endl;
                 }
             }
             else {
-                cout << "No time given." << endl;
+                out << "No time given." << endl;
             }
         }
         else if (argFlag == "-a") {
             // add an appointment using the appointment data string specified by the next argument
             if (argc >= 3) {  // check if next argument exists
-                Appointment newAppointment(argv[2]);
-                appointments.push_back(newAppointment);
+                LogOp op;
+                {
+                    AllocationScope parsing(ALLOC_PARSE);
+                    op = {LOG_ADD, Appointment(argv[2]).getAppointmentString()};
+                }
+                changeAgenda(op, session, log, tombstones);
             }
-
-            // save appointments to file
-            writeAppointments(appointments);
         }
         else if (argFlag == "-dt") {
-            // delete all appointments that match the title specified by the next argument
+            // delete all appointments that match the title specified by the next argument, in any case if the one after asks for it
             if (argc >= 3) {  // check if next argument exists
-                // remove all matches
-                for (size_t i = 0; i < appointments.size(); i++) {
-                    if (appointments[i].getTitle() == argv[2]) {
-                        appointments.erase(appointments.begin() + i);
-                        i--;
-                    }
-                }
-
-                // save appointments to file
-                writeAppointments(appointments);
+                bool ignoreCase = argc >= 4 && string(argv[3]) == "ignorecase";
+                LogOp op = {ignoreCase ? LOG_DELETE_TITLE_IGNORING_CASE : LOG_DELETE_TITLE, argv[2]};
+                changeAgenda(op, session, log, tombstones);
             }
             else {
-                cout << "No title given." << endl;
+                out << "No title given." << endl;
             }
         }
         else if (argFlag == "-dm") {
             // delete all appointments that match the starting time specified by the next argument
             if (argc >= 3) {  // check if next argument exists
                 if (isInt(argv[2])) {  // check if next argument contains an int
-                    int time = stoi(argv[2]);
+                    LogOp op = {LOG_DELETE_TIME, to_string(stoi(argv[2]))};
+                    changeAgenda(op, session, log, tombstones);
+                }
+                else {
+                    out << "Invalid time." << endl;
+                }
+            }
+            else {
+                out << "No time given." << endl;
+            }
+        }
+        else if (argFlag == "-dd") {
+            // delete every appointment that duplicates an earlier one, comparing normalized titles if the next argument asks for it
+            if (argc < 3 || string(argv[2]) == "normalize") {
+                if (session.resident) {
+                    bool normalize = argc >= 3;
+                    session.versions.change([&](Snapshot &next) {
+                        vector<Appointment> all;
+                        next.collect(all);
+                        TraceSpan deduping("remove duplicates");
+                        if (removeDuplicates(all, normalize) == 0) {
+                            return false;
+                        }
+                        next.replace(all);
+                        session.changed = true;
+                        if (session.writeThrough) {
+                            writeAppointments(all);
+                            log.clear();
+                            tombstones.clear();
+                        }
+                        return true;
+                    });
+                }
+                else {
+                    loadAppointments(appointments, index, tombstones);
+                    log.replay(appointments);
+                    TraceSpan deduping("remove duplicates");
+                    if (removeDuplicates(appointments, argc >= 3) > 0) {
+                        deduping.end();
+                        // the new agenda file makes the log and the tombstones stale, like a compaction
+                        writeAppointments(appointments);
+                        log.clear();
+                        tombstones.clear();
+                    }
+                }
+            }
+            else {
+                out << "Invalid arguments." << endl;
+            }
+        }
+        else if (argFlag == "-r") {
+            // print all appointments starting between the dates and times specified by the next arguments, in chronological order
+            if (argc >= 6) {  // check if both dates and times exist
+                int firstYear, firstMonth, firstDay, lastYear, lastMonth, lastDay;
+                if (!parseDate(argv[2], firstYear, firstMonth, firstDay) || !parseDate(argv[4], lastYear, lastMonth, lastDay)) {
+                    out << "Invalid date." << endl;
+                }
+                else if (!isInt(argv[3]) || !isInt(argv[5])) {
+                    out << "Invalid time." << endl;
+                }
+                else {
+                    uint64_t fromKey = AgendaIndex::chronoKey(AgendaIndex::packDate(firstYear, firstMonth, firstDay), stoi(argv[3]));
+                    uint64_t toKey = AgendaIndex::chronoKey(AgendaIndex::packDate(lastYear, lastMonth, lastDay), stoi(argv[5]));
+                    vector<uint32_t> records;  // record numbers of the matches in the appointment file
+                    vector<uint64_t> offsets;  // file offsets of the matches in the appointment file
+                    bool unchanged = !snapshot && log.coveredBy(tombstones) && tombstones.deadCount() == 0;  // whether the appointment file is the whole agenda
 
-                    // remove all matches
-                    for (size_t i = 0; i < appointments.size(); i++) {
-                        if (appointments[i].getTime() == time) {
-                            appointments.erase(appointments.begin() + i);
-                            i--;
+                    if (snapshot) {
+                        // page straight from the resident agenda's date ordering
+                        snapshot->pageDates(fromKey, toKey, pageOffset, pageLimit, appointments);
+                        printPage(out, appointments, 0, SIZE_MAX);
+                    }
+                    else if (unchanged && AgendaIndex::lookupDates(agendaPath, fromKey, toKey, pageOffset, pageLimit, records, offsets)) {
+                        // read only the lines on the page
+                        readAt(offsets, appointments);
+                        printPage(out, appointments, 0, SIZE_MAX);
+                    }
+                    else {
+                        // read the matches in the appointment file, or scan everything if the index is stale;
+                        // the log can add or delete matches, so sort and page after replaying it
+                        if (AgendaIndex::lookupDates(agendaPath, fromKey, toKey, 0, SIZE_MAX, records, offsets)) {
+                            readLive(records, offsets, tombstones, appointments);
+                            log.replay(appointments);
+                        }
+                        else {
+                            loadAgenda(snapshot.get(), log, tombstones, appointments, index);
                         }
+                        appointments.erase(remove_if(appointments.begin(), appointments.end(), [fromKey, toKey](const Appointment &appointment) {
+                            return AgendaIndex::chronoKey(appointment) < fromKey || AgendaIndex::chronoKey(appointment) > toKey;
+                        }), appointments.end());
+                        TraceSpan sorting("sort");
+                        stable_sort(appointments.begin(), appointments.end(), [](const Appointment &first, const Appointment &second) {
+                            return AgendaIndex::chronoKey(first) < AgendaIndex::chronoKey(second);
+                        });
+                        sorting.end();
+                        printPage(out, appointments, pageOffset, pageLimit);
                     }
+                }
+            }
+            else {
+                out << "No dates or times given." << endl;
+            }
+        }
+        else if (argFlag == "-o") {
+            // print all appointments that overlap the span of time on the date specified by the next arguments
+            if (argc >= 4) {  // check if the date and a time exist
+                int year, month, day;
+                if (!parseDate(argv[2], year, month, day)) {
+                    out << "Invalid date." << endl;
+                }
+                else if (!isInt(argv[3]) || (argc >= 5 && !isInt(argv[4]))) {
+                    out << "Invalid time." << endl;
+                }
+                else {
+                    // without an end time, find the appointments going on at the start time
+                    int64_t from = IntervalTree::toMinute(year, month, day, stoi(argv[3]));
+                    int64_t to = (argc >= 5) ? IntervalTree::toMinute(year, month, day, stoi(argv[4])) : from + 1;
+                    vector<Interval> intervals;
+                    bool fromIndex = loadIntervals(snapshot.get(), log, tombstones, intervals, appointments, index);
+                    IntervalTree tree;
+                    TraceSpan building("build interval tree");
+                    tree.build(intervals);
+                    building.end();
 
-                    // save appointments to file
-                    writeAppointments(appointments);
+                    vector<Appointment> matches;
+                    fetchAppointments(tree.overlapping(from, to), fromIndex, index, appointments, matches);
+                    printPage(out, matches, pageOffset, pageLimit);
+                }
+            }
+            else {
+                out << "No date or time given." << endl;
+            }
+        }
+        else if (argFlag == "-c") {
+            // print every group of appointments that overlap each other, separated by blank lines
+            vector<Interval> intervals;
+            bool fromIndex = loadIntervals(snapshot.get(), log, tombstones, intervals, appointments, index);
+            TraceSpan grouping("find conflicts");
+            vector<vector<size_t> > groups = findConflicts(intervals);
+            grouping.end();
+            for (size_t i = 0; i < groups.size(); i++) {
+                vector<Appointment> group;
+                fetchAppointments(groups[i], fromIndex, index, appointments, group);
+                if (i > 0) {
+                    out << endl;
+                }
+                printPage(out, group, 0, SIZE_MAX);
+            }
+        }
+        else if (argFlag == "-f") {
+            // print the free spans of at least the given length between the dates specified by the next arguments
+            if (argc >= 5) {  // check if both dates and the length exist
+                int firstYear, firstMonth, firstDay, lastYear, lastMonth, lastDay;
+                int minimum = 0;
+                int dayStart = 900;  // working hours default to 9AM-5PM
+                int dayEnd = 1700;
+                if (!parseDate(argv[2], firstYear, firstMonth, firstDay) || !parseDate(argv[3], lastYear, lastMonth, lastDay)) {
+                    out << "Invalid date." << endl;
+                }
+                else if (!parseNumber(argv[4], minimum) || (argc >= 7 && (!parseNumber(argv[5], dayStart) || !parseNumber(argv[6], dayEnd)))
+                    || dayStart % 100 >= 60 || dayEnd % 100 >= 60 || dayStart >= dayEnd || dayEnd > 2400) {
+                    out << "Invalid time." << endl;
                 }
                 else {
-                    cout << "Invalid time." << endl;
+                    int64_t firstMinute = IntervalTree::toMinute(firstYear, firstMonth, firstDay, 0);
+                    int64_t lastMinute = IntervalTree::toMinute(lastYear, lastMonth, lastDay, 0);
+                    vector<Interval> intervals;
+                    loadIntervals(snapshot.get(), log, tombstones, intervals, appointments, index);
+
+                    // only the appointments that reach into the range need to be merged
+                    vector<Interval> busy;
+                    for (size_t i = 0; i < intervals.size(); i++) {
+                        if (intervals[i].start < lastMinute + 1440 && intervals[i].end > firstMinute) {
+                            busy.push_back(intervals[i]);
+                        }
+                    }
+
+                    vector<Interval> slots = findFreeSlots(busy, firstMinute, lastMinute, dayStart, dayEnd, minimum);
+                    PhaseTimer printing(STATS_OUTPUT);
+                    for (size_t i = pageOffset; i < slots.size() && i - pageOffset < pageLimit; i++) {
+                        out << formatMinute(slots[i].start) << "|" << formatMinute(slots[i].end).substr(11) << "|" << (slots[i].end - slots[i].start) << endl;
+                        countPhase(STATS_OUTPUT, 1);
+                    }
                 }
             }
             else {
-                cout << "No time given." << endl;
+                out << "No dates or length given." << endl;
+            }
+        }
+        else if (argFlag == "-g") {
+            // print the number and total duration of appointments per day, week or month, optionally between two dates
+            if (argc >= 3) {  // check if the span exists
+                string spanName = argv[2];
+                int span = (spanName == "day") ? BUCKET_DAY : (spanName == "week") ? BUCKET_WEEK : (spanName == "month") ? BUCKET_MONTH : -1;
+                int firstYear, firstMonth, firstDay, lastYear, lastMonth, lastDay;
+                if (span < 0) {
+                    out << "Invalid span." << endl;
+                }
+                else if (argc >= 5 && (!parseDate(argv[3], firstYear, firstMonth, firstDay) || !parseDate(argv[4], lastYear, lastMonth, lastDay))) {
+                    out << "Invalid date." << endl;
+                }
+                else {
+                    uint32_t firstDate = (argc >= 5) ? AgendaIndex::packDate(firstYear, firstMonth, firstDay) : 0;
+                    uint32_t lastDate = (argc >= 5) ? AgendaIndex::packDate(lastYear, lastMonth, lastDay) : UINT32_MAX;
+                    vector<uint32_t> dates;  // packed date of every appointment in the range
+                    vector<int> durations;   // duration of every appointment in the range
+
+                    if (!snapshot && log.coveredBy(tombstones) && index.load(agendaPath)) {
+                        // the index has the date and duration of every record, so no line has to be parsed
+                        for (size_t i = 0; i < index.size(); i++) {
+                            const IndexEntry &entry = index.at(i);
+                            if (!tombstones.isDead(i) && entry.date >= firstDate && entry.date <= lastDate) {
+                                dates.push_back(entry.date);
+                                durations.push_back(entry.duration);
+                            }
+                        }
+                    }
+                    else {
+                        loadAgenda(snapshot.get(), log, tombstones, appointments, index);
+                        for (size_t i = 0; i < appointments.size(); i++) {
+                            uint32_t date = AgendaIndex::packDate(appointments[i].getYear(), appointments[i].getMonth(), appointments[i].getDay());
+                            if (date >= firstDate && date <= lastDate) {
+                                dates.push_back(date);
+                                durations.push_back(appointments[i].getDuration());
+                            }
+                        }
+                    }
+
+                    vector<Bucket> buckets = sumBuckets(dates, durations, span);
+                    PhaseTimer printing(STATS_OUTPUT);
+                    for (size_t i = pageOffset; i < buckets.size() && i - pageOffset < pageLimit; i++) {
+                        out << formatBucket(buckets[i].key, span) << "|" << buckets[i].count << "|" << buckets[i].duration << endl;
+                        countPhase(STATS_OUTPUT, 1);
+                    }
+                }
+            }
+            else {
+                out << "No span given." << endl;
+            }
+        }
+        else if (argFlag == "-t") {
+            // print all appointments whose titles contain the text specified by the next argument in any case,
+            // or start with it if the one after asks for it
+            if (argc >= 3) {  // check if next argument exists
+                bool prefix = argc >= 4 && string(argv[3]) == "prefix";
+                if (snapshot) {
+                    snapshot->findTitles(argv[2], prefix, pageOffset, pageLimit, appointments);
+                    printPage(out, appointments, 0, SIZE_MAX);
+                }
+                else {
+                    // one search reads every title anyway, so it checks them instead of indexing them first:
+                    // building the index folds and reads every title as well, and then keeps tables of their trigrams
+                    string folded = argv[2];
+                    Appointment::foldCase(folded.data(), folded.length());
+                    loadAgenda(snapshot.get(), log, tombstones, appointments, index);
+                    TraceSpan searching("search titles");
+                    appointments.erase(remove_if(appointments.begin(), appointments.end(), [&folded, prefix](const Appointment &appointment) {
+                        return !TrigramIndex::titleMatches(appointment.getTitle(), folded, prefix);
+                    }), appointments.end());
+                    searching.end();
+                    printPage(out, appointments, pageOffset, pageLimit);
+                }
+            }
+            else {
+                out << "No text given." << endl;
             }
         }
         else {
-            cout << "Invalid arguments." << endl;
+            out << "Invalid arguments." << endl;
         }
     }
     else {
-        cout << "Missing arguments." << endl;
+        out << "Missing arguments." << endl;
     }
+}
 
-    return 0;
-}// main
 
-bool isInt(string input) {
+void runBatch(istream &script, const string &programName, AgendaLog &log, Tombstones &tombstones) {
+    AllocationScope querying(ALLOC_QUERY);
+    TraceSpan loading("load batch");
+    Session session;
+    AgendaIndex index;
+    vector<Appointment> appointments;
+    bool sharded = isSharded(AGENDA_FILE_NAME);
+    if (sharded) {
+        loadShards(listShards(AGENDA_FILE_NAME), appointments);
+    }
+    else {
+        loadAppointments(appointments, index, tombstones);
+        log.replay(appointments);
+    }
+    session.versions.reset(appointments);
+    session.resident = true;
+    loading.end();
+    reportAllocations(cerr, "-b");
+
+    string lineIn;
+    while (getline(script, lineIn)) {
+        runLine(lineIn, programName, log, tombstones, session, cout);
+        reportAllocations(cerr, lineIn);
+    }
+
+    // write the agenda once; the new file makes the log and the tombstones stale, like a compaction
+    if (session.changed) {
+        TraceSpan saving("save batch");
+        appointments.clear();
+        session.versions.current()->collect(appointments);
+        if (sharded) {
+            writeShards(appointments, listShards(AGENDA_FILE_NAME));
+        }
+        else {
+            writeAppointments(appointments);
+            log.clear();
+            tombstones.clear();
+        }
+    }
+}
+
+void runServer(const string &programName, AgendaLog &log, Tombstones &tombstones) {
+    Session session;
+    AgendaIndex index;
+    vector<Appointment> appointments;
+    loadAppointments(appointments, index, tombstones);
+    log.replay(appointments);
+    session.versions.reset(appointments);
+    session.versions.setCopyOnWrite(true);  // requests run on their own threads
+    session.resident = true;
+    session.writeThrough = true;
+
+    // each request runs like a line of a batch script, with its output captured for the response
+    bool started = serveRequests(SOCKET_FILE_NAME, [&](const string &line) {
+        ostringstream output;
+        runLine(line, programName, log, tombstones, session, output);
+
+        return output.str();
+    });
+    if (!started) {
+        cout << "Failed to start server." << endl;
+    }
+}
+
+void runLine(const string &line, const string &programName, AgendaLog &log, Tombstones &tombstones, Session &session, ostream &out) {
+    vector<string> args = splitCommand(line);
+    if (args.empty() || args[0][0] == '#') {
+        return;
+    }
+    TraceSpan span("line", line);
+
+    // run the line as if it were the program's own arguments
+    args.insert(args.begin(), programName);
+    vector<char const *> argv;
+    for (size_t i = 0; i < args.size(); i++) {
+        argv.push_back(args[i].c_str());
+    }
+    runCommand(argv.size(), argv.data(), log, tombstones, session, out);
+}
+
+bool changesAgenda(const string &argFlag) {
+    return argFlag == "-a" || argFlag == "-dt" || argFlag == "-dm" || argFlag == "-dd" || argFlag == "-b" || argFlag == "-server"
+        || argFlag == "-shard" || argFlag == "-unshard";
+}
+
+bool isInt(string_view input) {
     // scan through each character until a digit is found
     for (size_t i = 0; i < input.length(); i++) {
         if (isdigit(input[i])) {
@@ -177,11 +1031,555 @@ bool isInt(string input) {
     return false;
 }
 
-void writeAppointments(const vector<Appointment> appointments) {
+bool parseNumber(string_view input, int &value) {
+    if (input.empty() || input.find_first_not_of("0123456789") != string_view::npos) {
+        return false;
+    }
+    value = Appointment::toInt(input);
+
+    return value >= 0;
+}
+
+bool parseDate(const string &input, int &year, int &month, int &day) {
+    size_t firstDash = input.find('-');
+    size_t secondDash = input.find('-', firstDash + 1);
+    if (firstDash == string::npos || secondDash == string::npos) {
+        return false;
+    }
+
+    string yearString = input.substr(0, firstDash);
+    string monthString = input.substr(firstDash + 1, secondDash - firstDash - 1);
+    string dayString = input.substr(secondDash + 1);
+    if (!isInt(yearString) || !isInt(monthString) || !isInt(dayString)) {
+        return false;
+    }
+
+    year = stoi(yearString);
+    month = stoi(monthString);
+    day = stoi(dayString);
+
+    return year >= 0 && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+string formatMinute(int64_t minute) {
+    int year, month, day, time;
+    IntervalTree::fromMinute(minute, year, month, day, time);
+
+    Appointment formatter;  // only used for its date and time formatting
+    formatter.setDate(year, month, day);
+
+    return formatter.getDate() + "|" + formatter.militaryToStandard(time);
+}
+
+int extractPaging(int argc, char const *argv[], size_t &pageOffset, size_t &pageLimit) {
+    int kept = 0;  // number of arguments kept so far
+    pageOffset = 0;
+    pageLimit = SIZE_MAX;
+
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--offset" || arg == "--limit") {
+            if (i + 1 >= argc || !isInt(argv[i + 1]) || stoll(argv[i + 1]) < 0) {
+                return -1;
+            }
+            size_t value = stoull(argv[i + 1]);
+            if (arg == "--offset") {
+                pageOffset = value;
+            }
+            else {
+                pageLimit = value;
+            }
+            i++;
+        }
+        else {
+            argv[kept] = argv[i];
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+int extractStats(int argc, char const *argv[]) {
+    int kept = 0;  // number of arguments kept so far
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--stats" || arg == "--stats=json") {
+            enableStats(arg == "--stats=json");
+        }
+        else {
+            argv[kept] = argv[i];
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+int extractArena(int argc, char const *argv[], bool &useArena) {
+    int kept = 0;  // number of arguments kept so far
+    useArena = false;
+    for (int i = 0; i < argc; i++) {
+        if (string(argv[i]) == "--arena") {
+            useArena = true;
+        }
+        else {
+            argv[kept] = argv[i];
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+int extractTrace(int argc, char const *argv[], string &tracePath) {
+    int kept = 0;  // number of arguments kept so far
+    tracePath.clear();
+    for (int i = 0; i < argc; i++) {
+        if (string(argv[i]) == "--trace") {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            tracePath = argv[i + 1];
+            startTrace();
+            i++;
+        }
+        else {
+            argv[kept] = argv[i];
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+void readAt(const vector<uint64_t> &offsets, vector<Appointment> &appointments) {
+    TraceSpan span("read lines");
+    AllocationScope parsing(ALLOC_PARSE);
+    ifstream agendaFile(agendaPath, ios::binary);
+    string lineIn;
+    appointments.reserve(appointments.size() + offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++) {
+        {
+            PhaseTimer reading(STATS_READ);
+            agendaFile.seekg(offsets[i]);
+            getline(agendaFile, lineIn);
+            countPhase(STATS_READ, 1, lineIn.length() + 1);
+        }
+        PhaseTimer parsingTimer(STATS_PARSE);
+        appointments.emplace_back(lineIn);
+        countPhase(STATS_PARSE, 1);
+    }
+}
+
+void readLive(const vector<uint32_t> &records, const vector<uint64_t> &offsets, const Tombstones &tombstones, vector<Appointment> &appointments) {
+    vector<uint64_t> liveOffsets;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!tombstones.isDead(records[i])) {
+            liveOffsets.push_back(offsets[i]);
+        }
+    }
+    readAt(liveOffsets, appointments);
+}
+
+string formatBucket(uint32_t key, int span) {
+    ostringstream formatted;
+    formatted << setfill('0');
+    if (span == BUCKET_DAY) {
+        formatted << setw(4) << key / 10000 << "-" << setw(2) << key / 100 % 100 << "-" << setw(2) << key % 100;
+    }
+    else {
+        formatted << setw(4) << key / 100 << ((span == BUCKET_WEEK) ? "-W" : "-") << setw(2) << key % 100;
+    }
+
+    return formatted.str();
+}
+
+void printPage(ostream &out, const vector<Appointment> &appointments, size_t pageOffset, size_t pageLimit) {
+    AllocationScope formatting(ALLOC_FORMAT);
+    PhaseTimer printing(STATS_OUTPUT);
+    string line;  // reused, so its storage only grows for the longest line
+    for (size_t i = pageOffset; i < appointments.size() && i - pageOffset < pageLimit; i++) {
+        line.clear();
+        appointments[i].appendAppointmentString(line);
+        out << line << endl;
+        countPhase(STATS_OUTPUT, 1, 0, line.length() + 1);
+    }
+}
+
+void loadAppointments(vector<Appointment> &appointments, AgendaIndex &index, const Tombstones &tombstones) {
+    TraceSpan span("load", agendaPath);
+    ifstream appointmentFile;  // file with each appointment string on a separate line
+    string contents;           // the whole appointment file
+
+    PhaseTimer reading(STATS_READ);
+    TraceSpan readingSpan("read file");
+    appointmentFile.open(agendaPath, ios::binary | ios::ate);
+    if (appointmentFile.fail()) {
+        cout << "Failed to open file." << endl;
+        exit(0);
+    }
+
+    bool indexFresh = AgendaIndex::isFresh(agendaPath);
+    index.clear();
+
+    // read the whole file at once
+    contents.resize(appointmentFile.tellg());
+    appointmentFile.seekg(0);
+    appointmentFile.read(&contents[0], contents.size());
+    appointmentFile.close();
+    reading.stop();
+    readingSpan.end();
+
+    parseAgenda(contents, tombstones, loadArena, appointments, index);
+
+    if (!indexFresh) {
+        AllocationScope writing(ALLOC_WRITE);
+        PhaseTimer writingTimer(STATS_WRITE);
+        index.save(agendaPath);
+        countPhase(STATS_WRITE, index.size());
+    }
+}
+
+void loadAgenda(const Snapshot *snapshot, const AgendaLog &log, const Tombstones &tombstones, vector<Appointment> &appointments, AgendaIndex &index) {
+    if (snapshot) {
+        TraceSpan span("collect snapshot");
+        appointments.clear();
+        snapshot->collect(appointments);
+        return;
+    }
+
+    loadAppointments(appointments, index, tombstones);
+    TraceSpan replaying("replay log");
+    log.replay(appointments);
+}
+
+bool loadIntervals(const Snapshot *snapshot, const AgendaLog &log, const Tombstones &tombstones, vector<Interval> &intervals, vector<Appointment> &appointments, AgendaIndex &index) {
+    if (!snapshot && log.coveredBy(tombstones) && index.load(agendaPath)) {
+        // the index has the date, time and duration of every record
+        for (size_t i = 0; i < index.size(); i++) {
+            const IndexEntry &entry = index.at(i);
+            if (!tombstones.isDead(i)) {
+                intervals.push_back(IntervalTree::makeInterval(entry.date / 10000, entry.date / 100 % 100, entry.date % 100, entry.time, entry.duration, i));
+            }
+        }
+
+        return true;
+    }
+
+    loadAgenda(snapshot, log, tombstones, appointments, index);
+    for (size_t i = 0; i < appointments.size(); i++) {
+        const Appointment &appointment = appointments[i];
+        intervals.push_back(IntervalTree::makeInterval(appointment.getYear(), appointment.getMonth(), appointment.getDay(), appointment.getTime(), appointment.getDuration(), i));
+    }
+
+    return false;
+}
+
+void fetchAppointments(const vector<size_t> &ids, bool fromIndex, const AgendaIndex &index, const vector<Appointment> &appointments, vector<Appointment> &matches) {
+    if (fromIndex) {
+        // read only the lines of the matching records
+        vector<uint64_t> offsets;
+        for (size_t i = 0; i < ids.size(); i++) {
+            offsets.push_back(index.at(ids[i]).offset);
+        }
+        readAt(offsets, matches);
+    }
+    else {
+        for (size_t i = 0; i < ids.size(); i++) {
+            matches.push_back(appointments[ids[i]]);
+        }
+    }
+}
+
+void writeAppointments(const vector<Appointment> &appointments) {
     ofstream appointmentFile;
-    appointmentFile.open(AGENDA_FILE_NAME);
+    AgendaIndex index;    // rebuilt while writing, so the new file never has to be read back
+    uint64_t offset = 0;  // byte offset of the next line
+    string tempName = agendaPath + ".tmp";
+    TraceSpan span("write", agendaPath);
+    AllocationScope writing(ALLOC_WRITE);
+    PhaseTimer writingTimer(STATS_WRITE);
+
+    // write a new file and swap it in, so a crash never leaves a half-written agenda or loses logged changes
+    appointmentFile.open(tempName, ios::binary);
+    string line;  // reused, so its storage only grows for the longest line
     for (size_t i = 0; i < appointments.size(); i++) {
-        appointmentFile << appointments[i].getAppointmentString() << endl;
+        {
+            AllocationScope formatting(ALLOC_FORMAT);
+            line.clear();
+            appointments[i].appendAppointmentString(line);
+        }
+        appointmentFile << line << '\n';
+        index.addRecord(appointments[i], offset);
+        offset += line.length() + 1;
     }
     appointmentFile.close();
-}
\ No newline at end of file
+    AgendaLog::commitAgenda(agendaPath, tempName);
+    countPhase(STATS_WRITE, appointments.size(), 0, offset);
+
+    index.save(agendaPath);
+}
+
+void deleteAppointments(char type, const string &data, AgendaLog &log, Tombstones &tombstones) {
+    AgendaIndex index;
+    if (!index.load(agendaPath)) {
+        vector<Appointment> appointments;
+        loadAppointments(appointments, index, tombstones);  // rebuilds the index
+    }
+    tombstones.resize(index.size());
+
+    // a crash between logging a delete and saving the bitmap leaves it stale, so every logged delete is marked again
+    bool remarked = !tombstones.isCurrent();
+    bool logsAdds = false;  // whether the log holds appointments the delete could match
+    const vector<LogOp> &ops = log.operations();
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i].type == LOG_ADD) {
+            logsAdds = true;
+        }
+        else if (remarked) {
+            markMatches(ops[i].type, ops[i].data, index, tombstones);
+        }
+    }
+
+    // a delete that matches nothing in the file or the log leaves the agenda as it is, so nothing is written for it
+    if (!markMatches(type, data, index, tombstones) && !logsAdds) {
+        if (remarked) {
+            tombstones.save();
+        }
+        return;
+    }
+
+    // logged before the bitmap is saved, so a crash between them leaves a stale bitmap and not a lost delete
+    AllocationScope writing(ALLOC_WRITE);
+    PhaseTimer writingTimer(STATS_WRITE);
+    log.append(type, data);
+    countPhase(STATS_WRITE, 1, 0, data.length() + 3);
+    tombstones.save();
+}
+
+bool markMatches(char type, const string &data, const AgendaIndex &index, Tombstones &tombstones) {
+    // find the live matches through the index
+    vector<uint32_t> candidates = (type == LOG_DELETE_TIME) ? index.findTime(stoi(data)) : index.findTitle(data);
+    vector<uint32_t> records;
+    vector<uint64_t> offsets;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (!tombstones.isDead(candidates[i])) {
+            records.push_back(candidates[i]);
+            offsets.push_back(index.at(candidates[i]).offset);
+        }
+    }
+
+    // titles only match by hash, and the hash ignores case, so read them back before deleting
+    uint32_t key = Appointment::foldedHash(data);
+    vector<Appointment> appointments;
+    readAt(offsets, appointments);
+    bool marked = false;
+    for (size_t i = 0; i < records.size(); i++) {
+        bool matches = (type == LOG_DELETE_TIME) || ((type == LOG_DELETE_TITLE) ? appointments[i].getTitle() == string_view(data) : appointments[i].matchesTitle(data, key));
+        if (matches) {
+            marked = tombstones.mark(records[i]) || marked;
+        }
+    }
+
+    return marked;
+}
+
+void compactAgenda(const Snapshot *snapshot, AgendaLog &log, Tombstones &tombstones) {
+    if (log.size() < LOG_COMPACT_BYTES && tombstones.deadFraction() <= DEAD_COMPACT_FRACTION) {
+        return;
+    }
+
+    vector<Appointment> appointments;
+    AgendaIndex index;
+    if (!snapshot) {
+        log.read();  // picks up the operations appended since the log was first read
+    }
+    loadAgenda(snapshot, log, tombstones, appointments, index);
+
+    // the new agenda file makes the log and the tombstones stale, so a crash before clearing them can't apply them twice
+    writeAppointments(appointments);
+    log.clear();
+    tombstones.clear();
+}
+
+void changeAgenda(const LogOp &op, Session &session, AgendaLog &log, Tombstones &tombstones) {
+    if (session.resident) {
+        session.versions.change([&](Snapshot &next) {
+            if (op.type == LOG_ADD) {
+                Appointment added;
+                {
+                    AllocationScope parsing(ALLOC_PARSE);
+                    added = Appointment(op.data);
+                }
+                next.add(added);
+            }
+            else {
+                vector<Appointment> all;
+                next.collect(all);
+                AgendaLog::apply(op, all);
+                if (all.size() == next.size()) {
+                    return false;  // nothing matched, so there is no new version and nothing to log
+                }
+                next.replace(all);
+            }
+            session.changed = true;
+
+            // logged before the version is published, so nobody reads a change that could still be lost
+            if (session.writeThrough) {
+                AllocationScope writing(ALLOC_WRITE);
+                PhaseTimer writingTimer(STATS_WRITE);
+                log.append(op.type, op.data);
+                countPhase(STATS_WRITE, 1, 0, op.data.length() + 3);
+                compactAgenda(&next, log, tombstones);
+            }
+            return true;
+        });
+        return;
+    }
+
+    if (op.type == LOG_ADD) {
+        AllocationScope writing(ALLOC_WRITE);
+        PhaseTimer writingTimer(STATS_WRITE);
+        log.append(op.type, op.data);
+        countPhase(STATS_WRITE, 1, 0, op.data.length() + 3);  // the type, a bar and a newline around the data
+    }
+    else {
+        deleteAppointments(op.type, op.data, log, tombstones);
+    }
+    compactAgenda(NULL, log, tombstones);
+}
+
+void runSharded(int argc, char const *argv[], AgendaLog &log, Tombstones &tombstones) {
+    string argFlag = (argc >= 2) ? argv[1] : "";
+    vector<string> paths = listShards(AGENDA_FILE_NAME);
+    if (argFlag == "-a" && argc >= 3) {
+        Appointment added(argv[2]);
+        string path = shardPath(AGENDA_FILE_NAME, shardKey(added.getYear(), added.getMonth()));
+        ofstream(path, ios::app).close();  // the first appointment of a month starts its shard
+        cout << runOnShard(path, argc, argv);
+        return;
+    }
+    if ((argFlag == "-dt" || argFlag == "-dm" || argFlag == "-dd") && !paths.empty()) {
+        // any shard can hold a match; every shard reports the same argument errors, so only the first is printed
+        for (size_t i = 0; i < paths.size(); i++) {
+            string output = runOnShard(paths[i], argc, argv);
+            if (i == 0) {
+                cout << output;
+            }
+        }
+        return;
+    }
+
+    // commands that take dates only need the months they cover, and the month before for appointments running into them
+    int firstYear, firstMonth, firstDay, lastYear, lastMonth, lastDay;
+    int firstKey = 0, lastKey = INT_MAX;
+    if ((argFlag == "-r" && argc >= 6 && parseDate(argv[2], firstYear, firstMonth, firstDay) && parseDate(argv[4], lastYear, lastMonth, lastDay))
+        || (argFlag == "-g" && argc >= 5 && parseDate(argv[3], firstYear, firstMonth, firstDay) && parseDate(argv[4], lastYear, lastMonth, lastDay))) {
+        firstKey = shardKey(firstYear, firstMonth);
+        lastKey = shardKey(lastYear, lastMonth);
+    }
+    else if ((argFlag == "-o" && argc >= 4 && parseDate(argv[2], firstYear, firstMonth, firstDay) && parseDate(argv[2], lastYear, lastMonth, lastDay))
+        || (argFlag == "-f" && argc >= 5 && parseDate(argv[2], firstYear, firstMonth, firstDay) && parseDate(argv[3], lastYear, lastMonth, lastDay))) {
+        firstKey = (firstMonth == 1) ? shardKey(firstYear - 1, 12) : shardKey(firstYear, firstMonth - 1);
+        lastKey = shardKey(lastYear, lastMonth);
+    }
+
+    Session session;
+    vector<Appointment> appointments;
+    loadShards(listShards(AGENDA_FILE_NAME, firstKey, lastKey), appointments);
+    session.versions.reset(appointments);
+    session.resident = true;
+    runCommand(argc, argv, log, tombstones, session, cout);
+}
+
+string runOnShard(const string &path, int argc, char const *argv[]) {
+    AgendaLog log(path);
+    Tombstones tombstones(path);
+    Session session;  // nothing resident, so the command works straight on the shard's files
+    ostringstream output;
+    PhaseTimer opening(STATS_OPEN);
+    log.read();
+    tombstones.read();
+    opening.stop();
+
+    agendaPath = path;
+    runCommand(argc, argv, log, tombstones, session, output);
+    agendaPath = AGENDA_FILE_NAME;
+
+    return output.str();
+}
+
+void loadShards(const vector<string> &paths, vector<Appointment> &appointments) {
+    appointments.clear();
+    for (size_t i = 0; i < paths.size(); i++) {
+        AgendaLog log(paths[i]);
+        Tombstones tombstones(paths[i]);
+        AgendaIndex index;
+        vector<Appointment> shard;
+        PhaseTimer opening(STATS_OPEN);
+        log.read();
+        tombstones.read();
+        opening.stop();
+
+        agendaPath = paths[i];
+        loadAgenda(NULL, log, tombstones, shard, index);
+        agendaPath = AGENDA_FILE_NAME;
+        appointments.insert(appointments.end(), make_move_iterator(shard.begin()), make_move_iterator(shard.end()));
+    }
+}
+
+void writeShards(const vector<Appointment> &appointments, const vector<string> &replaced) {
+    map<int, vector<Appointment> > months;  // appointments of each shard, by key
+    for (size_t i = 0; i < appointments.size(); i++) {
+        months[shardKey(appointments[i].getYear(), appointments[i].getMonth())].push_back(appointments[i]);
+    }
+
+    vector<string> written;  // paths of the shards written
+    mkdir(shardDirectory(AGENDA_FILE_NAME).c_str(), 0755);
+    for (map<int, vector<Appointment> >::iterator i = months.begin(); i != months.end(); ++i) {
+        string path = shardPath(AGENDA_FILE_NAME, i->first);
+        written.push_back(path);
+        AgendaLog log(path);
+        Tombstones tombstones(path);
+
+        // the new file makes the shard's log and tombstones stale, like a compaction
+        agendaPath = path;
+        writeAppointments(i->second);
+        agendaPath = AGENDA_FILE_NAME;
+        log.clear();
+        tombstones.clear();
+    }
+    for (size_t i = 0; i < replaced.size(); i++) {
+        if (find(written.begin(), written.end(), replaced[i]) == written.end()) {
+            removeShard(replaced[i]);
+        }
+    }
+}
+
+void shardAgenda(AgendaLog &log, Tombstones &tombstones) {
+    vector<Appointment> appointments;
+    AgendaIndex index;
+    loadAgenda(NULL, log, tombstones, appointments, index);
+
+    // the shards are complete before the agenda file is emptied, so a crash in between loses nothing
+    writeShards(appointments, vector<string>());
+    writeAppointments(vector<Appointment>());
+    log.clear();
+    tombstones.clear();
+}
+
+void unshardAgenda(AgendaLog &log, Tombstones &tombstones) {
+    vector<string> paths = listShards(AGENDA_FILE_NAME);
+    vector<Appointment> appointments;
+    loadShards(paths, appointments);
+
+    // the agenda file is complete before the shards go, and the agenda counts as sharded until the directory is gone
+    writeAppointments(appointments);
+    log.clear();
+    tombstones.clear();
+    for (size_t i = 0; i < paths.size(); i++) {
+        removeShard(paths[i]);
+    }
+    rmdir(shardDirectory(AGENDA_FILE_NAME).c_str());
+}
@@ -0,0 +1,111 @@
+#include <vector>
+#include <algorithm>
+#include "interval_tree.h"
+using namespace std;
+
+///constructors
+
+IntervalTree::IntervalTree() {
+}
+
+
+///building
+
+void IntervalTree::build(const vector<Interval> &intervals) {
+    sorted = intervals;
+    stable_sort(sorted.begin(), sorted.end(), [](const Interval &first, const Interval &second) {
+        return first.start < second.start;
+    });
+    maxEnd.assign(sorted.size(), 0);
+    buildMaxEnd(0, sorted.size());
+}
+
+int64_t IntervalTree::buildMaxEnd(size_t first, size_t last) {
+    if (first >= last) {
+        return INT64_MIN;
+    }
+
+    size_t middle = first + (last - first) / 2;
+    maxEnd[middle] = max(sorted[middle].end, max(buildMaxEnd(first, middle), buildMaxEnd(middle + 1, last)));
+
+    return maxEnd[middle];
+}
+
+
+///queries
+
+vector<size_t> IntervalTree::overlapping(int64_t from, int64_t to) const {
+    vector<size_t> matches;
+    collect(0, sorted.size(), from, to, matches);
+
+    return matches;
+}
+
+vector<size_t> IntervalTree::stabbing(int64_t at) const {
+    return overlapping(at, at + 1);
+}
+
+void IntervalTree::collect(size_t first, size_t last, int64_t from, int64_t to, vector<size_t> &matches) const {
+    if (first >= last) {
+        return;
+    }
+
+    size_t middle = first + (last - first) / 2;
+    if (maxEnd[middle] <= from) {
+        return;  // everything in this subtree ends before the span
+    }
+
+    // visit in order so the matches come out sorted by start
+    collect(first, middle, from, to, matches);
+    if (sorted[middle].start < to) {
+        if (sorted[middle].end > from) {
+            matches.push_back(sorted[middle].id);
+        }
+        collect(middle + 1, last, from, to, matches);  // starts to the right are only worth checking if this one is early enough
+    }
+}
+
+size_t IntervalTree::size() const {
+    return sorted.size();
+}
+
+
+///helpers
+
+int64_t IntervalTree::toMinute(int year, int month, int day, int time) {
+    // days since 1970-01-01 in the proleptic Gregorian calendar, counting years from March so leap days come last
+    int64_t shiftedYear = (month <= 2) ? year - 1 : year;
+    int64_t era = (shiftedYear >= 0 ? shiftedYear : shiftedYear - 399) / 400;
+    int64_t yearOfEra = shiftedYear - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int64_t days = era * 146097 + dayOfEra - 719468;
+
+    return days * 1440 + (time / 100) * 60 + time % 100;
+}
+
+void IntervalTree::fromMinute(int64_t minute, int &year, int &month, int &day, int &time) {
+    // inverse of toMinute
+    int64_t days = (minute >= 0 ? minute : minute - 1439) / 1440;
+    int64_t minuteOfDay = minute - days * 1440;
+    time = (minuteOfDay / 60) * 100 + minuteOfDay % 60;
+
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+Interval IntervalTree::makeInterval(int year, int month, int day, int time, int duration, size_t id) {
+    Interval interval;
+    interval.start = toMinute(year, month, day, time);
+    interval.end = interval.start + max(duration, 1);
+    interval.id = id;
+
+    return interval;
+}
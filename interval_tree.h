@@ -0,0 +1,109 @@
+/**
+ *   @file: interval_tree.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Static interval tree for finding the appointments that overlap a span of time.
+ */
+
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+struct Interval {
+    int64_t start;  // first minute of the interval, counted from 1970-01-01 12:00AM
+    int64_t end;    // minute after the last minute of the interval
+    size_t id;      // caller's number for the interval
+};
+
+class IntervalTree {
+    public:
+        /**
+         * @brief Construct a new empty IntervalTree object.
+         */
+        IntervalTree();
+
+        /**
+         * Function: build
+         * @brief Replaces the contents of the tree.
+         * 
+         * @param intervals the intervals to store
+         */
+        void build(const vector<Interval> &intervals);
+
+        /**
+         * Function: overlapping
+         * @brief Finds every interval that shares at least one minute with a span, in O(log n + k).
+         * 
+         * @param from first minute of the span
+         * @param to minute after the last minute of the span
+         * @return ids of the matching intervals, ordered by start with ties in insertion order
+         */
+        vector<size_t> overlapping(int64_t from, int64_t to) const;
+
+        /**
+         * Function: stabbing
+         * @brief Finds every interval that contains a minute.
+         * 
+         * @param at the minute
+         * @return ids of the matching intervals, ordered by start with ties in insertion order
+         */
+        vector<size_t> stabbing(int64_t at) const;
+
+        /**
+         * Function: size
+         * @brief Gets the number of intervals in the tree.
+         * 
+         * @return number of intervals
+         */
+        size_t size() const;
+
+        /**
+         * Function: toMinute
+         * @brief Converts a date and military time to minutes since 1970-01-01 12:00AM.
+         * 
+         * @return the absolute minute
+         */
+        static int64_t toMinute(int year, int month, int day, int time);
+
+        /**
+         * Function: fromMinute
+         * @brief Converts minutes since 1970-01-01 12:00AM back to a date and military time.
+         * 
+         * @param minute the absolute minute
+         * @param year receives the year
+         * @param month receives the month
+         * @param day receives the day
+         * @param time receives the time in military format
+         */
+        static void fromMinute(int64_t minute, int &year, int &month, int &day, int &time);
+
+        /**
+         * Function: makeInterval
+         * @brief Builds the interval covered by an appointment; an appointment with no duration covers its starting minute.
+         * 
+         * @return the interval
+         */
+        static Interval makeInterval(int year, int month, int day, int time, int duration, size_t id);
+    private:
+        /**
+         * Function: buildMaxEnd
+         * @brief Fills in the latest end of every subtree of sorted[first, last).
+         * 
+         * @return the latest end in the subtree
+         */
+        int64_t buildMaxEnd(size_t first, size_t last);
+
+        /**
+         * Function: collect
+         * @brief Adds the overlapping intervals of the subtree over sorted[first, last) to matches.
+         */
+        void collect(size_t first, size_t last, int64_t from, int64_t to, vector<size_t> &matches) const;
+
+        vector<Interval> sorted;  // intervals sorted by start, forming an implicit balanced tree rooted at the middle
+        vector<int64_t> maxEnd;   // latest end in the subtree rooted at each position of sorted
+};
+
+#endif
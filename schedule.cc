@@ -0,0 +1,135 @@
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "schedule.h"
+using namespace std;
+
+vector<vector<size_t> > findConflicts(const vector<Interval> &intervals) {
+    vector<vector<size_t> > groups;
+    vector<Interval> sorted = intervals;
+    stable_sort(sorted.begin(), sorted.end(), [](const Interval &first, const Interval &second) {
+        return first.start < second.start;
+    });
+
+    // sweep from left to right; a group stays open until an interval starts after everything in it has ended
+    vector<size_t> group;
+    int64_t groupEnd = INT64_MIN;  // latest end in the open group
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (sorted[i].start >= groupEnd) {
+            if (group.size() >= 2) {
+                groups.push_back(group);
+            }
+            group.clear();
+        }
+        group.push_back(sorted[i].id);
+        groupEnd = max(groupEnd, sorted[i].end);
+    }
+    if (group.size() >= 2) {
+        groups.push_back(group);
+    }
+
+    return groups;
+}
+
+vector<Interval> mergeIntervals(const vector<Interval> &intervals) {
+    vector<Interval> sorted = intervals;
+    sort(sorted.begin(), sorted.end(), [](const Interval &first, const Interval &second) {
+        return first.start < second.start;
+    });
+
+    vector<Interval> merged;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (!merged.empty() && sorted[i].start <= merged.back().end) {
+            merged.back().end = max(merged.back().end, sorted[i].end);
+        }
+        else {
+            merged.push_back(sorted[i]);
+            merged.back().id = 0;
+        }
+    }
+
+    return merged;
+}
+
+vector<Interval> findFreeSlots(const vector<Interval> &busy, int64_t firstDay, int64_t lastDay, int dayStart, int dayEnd, int minimum) {
+    vector<Interval> merged = mergeIntervals(busy);
+    vector<Interval> slots;
+    int startOffset = (dayStart / 100) * 60 + dayStart % 100;  // working hours in minutes after midnight
+    int endOffset = (dayEnd / 100) * 60 + dayEnd % 100;
+
+    // an empty span isn't free time, even when the minimum is 0
+    minimum = max(minimum, 1);
+
+    // the windows move forward one day at a time, so the busy list is only walked once
+    size_t next = 0;  // first merged interval that could still reach into the current window
+    for (int64_t day = firstDay; day <= lastDay; day += 1440) {
+        int64_t windowStart = day + startOffset;
+        int64_t windowEnd = day + endOffset;
+        while (next < merged.size() && merged[next].end <= windowStart) {
+            next++;
+        }
+
+        int64_t freeStart = windowStart;
+        for (size_t i = next; i < merged.size() && merged[i].start < windowEnd; i++) {
+            if (merged[i].start - freeStart >= minimum) {
+                Interval slot = {freeStart, merged[i].start, 0};
+                slots.push_back(slot);
+            }
+            freeStart = max(freeStart, merged[i].end);
+        }
+        if (windowEnd - freeStart >= minimum) {
+            Interval slot = {freeStart, windowEnd, 0};
+            slots.push_back(slot);
+        }
+    }
+
+    return slots;
+}
+
+uint32_t bucketKey(uint32_t date, int span) {
+    if (span == BUCKET_MONTH) {
+        return date / 100;
+    }
+    if (span != BUCKET_WEEK) {
+        return date;
+    }
+
+    // an ISO week belongs to the year its Thursday falls in (1970-01-01 was a Thursday)
+    int64_t day = IntervalTree::toMinute(date / 10000, date / 100 % 100, date % 100, 0) / 1440;
+    int64_t weekday = ((day + 3) % 7 + 7) % 7;  // 0 for Monday
+    int64_t thursday = day - weekday + 3;
+    int year, month, dayOfMonth, time;
+    IntervalTree::fromMinute(thursday * 1440, year, month, dayOfMonth, time);
+    int64_t yearStart = IntervalTree::toMinute(year, 1, 1, 0) / 1440;
+
+    return year * 100 + (thursday - yearStart) / 7 + 1;
+}
+
+vector<Bucket> sumBuckets(const vector<uint32_t> &dates, const vector<int> &durations, int span) {
+    vector<Bucket> buckets;
+    unordered_map<uint32_t, size_t> slots;  // bucket key to its position in buckets
+    uint32_t lastDate = 0;                  // agendas are mostly grouped by date, so the last lookup is usually reused
+    size_t lastSlot = 0;
+
+    for (size_t i = 0; i < dates.size(); i++) {
+        if (i == 0 || dates[i] != lastDate) {
+            uint32_t key = bucketKey(dates[i], span);
+            unordered_map<uint32_t, size_t>::iterator found = slots.find(key);
+            if (found == slots.end()) {
+                Bucket bucket = {key, 0, 0};
+                found = slots.insert(make_pair(key, buckets.size())).first;
+                buckets.push_back(bucket);
+            }
+            lastDate = dates[i];
+            lastSlot = found->second;
+        }
+        buckets[lastSlot].count++;
+        buckets[lastSlot].duration += durations[i];
+    }
+
+    sort(buckets.begin(), buckets.end(), [](const Bucket &first, const Bucket &second) {
+        return first.key < second.key;
+    });
+
+    return buckets;
+}
@@ -0,0 +1,81 @@
+/**
+ *   @file: schedule.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Whole-agenda scheduling queries built on appointment intervals.
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <vector>
+#include <cstdint>
+#include "interval_tree.h"
+using namespace std;
+
+const int BUCKET_DAY = 0;    // one bucket per date, keyed YYYYMMDD
+const int BUCKET_WEEK = 1;   // one bucket per ISO 8601 week, keyed YYYYWW by week-numbering year
+const int BUCKET_MONTH = 2;  // one bucket per month, keyed YYYYMM
+
+struct Bucket {
+    uint32_t key;      // the bucket's packed date, week or month
+    size_t count;      // number of appointments starting in the bucket
+    int64_t duration;  // total duration of those appointments
+};
+
+/**
+ * Function: findConflicts
+ * @brief Finds the groups of appointments that overlap each other with a sort and a sweep line, in O(n log n).
+ * 
+ * Two intervals are in the same group if they overlap, directly or through other intervals in the group.
+ * 
+ * @param intervals one interval per appointment
+ * @return ids of the intervals in each group of two or more, groups and their members ordered by start
+ */
+vector<vector<size_t> > findConflicts(const vector<Interval> &intervals);
+
+/**
+ * Function: mergeIntervals
+ * @brief Merges intervals into the smallest sorted list of disjoint intervals covering the same minutes.
+ * 
+ * @param intervals the intervals, in any order
+ * @return the merged intervals ordered by start, with ids of 0
+ */
+vector<Interval> mergeIntervals(const vector<Interval> &intervals);
+
+/**
+ * Function: findFreeSlots
+ * @brief Finds the free spans of at least a given length within the working hours of each day in a range.
+ * 
+ * @param busy the busy intervals, in any order
+ * @param firstDay minute at which the first day starts, as returned by IntervalTree::toMinute
+ * @param lastDay minute at which the last day starts
+ * @param dayStart start of the working hours in military format
+ * @param dayEnd end of the working hours in military format
+ * @param minimum shortest free span to report, in minutes; empty spans are never reported
+ * @return the free spans ordered by start, with ids of 0
+ */
+vector<Interval> findFreeSlots(const vector<Interval> &busy, int64_t firstDay, int64_t lastDay, int dayStart, int dayEnd, int minimum);
+
+/**
+ * Function: bucketKey
+ * @brief Gets the key of the bucket a date falls into.
+ * 
+ * @param date the packed date (YYYYMMDD)
+ * @param span BUCKET_DAY, BUCKET_WEEK or BUCKET_MONTH
+ * @return YYYYMMDD, YYYYWW or YYYYMM
+ */
+uint32_t bucketKey(uint32_t date, int span);
+
+/**
+ * Function: sumBuckets
+ * @brief Counts the appointments and totals their durations per day, week or month in a single pass.
+ * 
+ * @param dates the packed starting date of each appointment
+ * @param durations the duration of each appointment, in the same order
+ * @param span BUCKET_DAY, BUCKET_WEEK or BUCKET_MONTH
+ * @return the non-empty buckets ordered by key
+ */
+vector<Bucket> sumBuckets(const vector<uint32_t> &dates, const vector<int> &durations, int span);
+
+#endif
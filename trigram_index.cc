@@ -0,0 +1,272 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "trigram_index.h"
+#include "agenda_trace.h"
+using namespace std;
+
+struct TrigramSlot {
+    uint32_t trigram;  // the trigram, EMPTY_SLOT if the slot is free
+    uint32_t count;    // uses of the trigram while counting, then where its next id goes in postings
+};
+
+const uint32_t EMPTY_SLOT = UINT32_MAX;  // trigrams only take 24 bits
+
+/**
+ * Function: findSlot
+ * @brief Finds the slot of a trigram in a table at most half full whose size is a power of two, or the free slot it would take.
+ */
+static size_t findSlot(const vector<TrigramSlot> &slots, uint32_t trigram) {
+    size_t slot = (static_cast<uint64_t>(trigram) * 0x9E3779B97F4A7C15ULL >> 32) & (slots.size() - 1);
+    while (slots[slot].trigram != trigram && slots[slot].trigram != EMPTY_SLOT) {
+        slot = (slot + 1) & (slots.size() - 1);
+    }
+
+    return slot;
+}
+
+/**
+ * Function: growSlots
+ * @brief Doubles the size of a table, moving every trigram to its new slot.
+ */
+static void growSlots(vector<TrigramSlot> &slots) {
+    vector<TrigramSlot> grown(slots.size() * 2, TrigramSlot{EMPTY_SLOT, 0});
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot].trigram != EMPTY_SLOT) {
+            grown[findSlot(grown, slots[slot].trigram)] = slots[slot];
+        }
+    }
+    slots.swap(grown);
+}
+
+///constructors
+
+TrigramIndex::TrigramIndex() {
+    titleStart.push_back(0);
+    postingStart.push_back(0);
+}
+
+
+///building
+
+void TrigramIndex::build(const vector<Appointment> &appointments) {
+    TraceSpan span("build trigram index");
+    size_t total = 0;  // chars in every title
+    for (size_t i = 0; i < appointments.size(); i++) {
+        total += appointments[i].getTitle().length();
+    }
+
+    folded.clear();
+    folded.reserve(total);
+    titleStart.clear();
+    titleStart.reserve(appointments.size() + 1);
+    for (size_t i = 0; i < appointments.size(); i++) {
+        titleStart.push_back(folded.length());
+        folded.append(appointments[i].getTitle());
+    }
+    titleStart.push_back(folded.length());
+    Appointment::foldCase(folded.data(), folded.length());
+
+    // the uses of each trigram are counted in a table that grows with the distinct trigrams, so small agendas stay cheap
+    vector<TrigramSlot> slots(1024, TrigramSlot{EMPTY_SLOT, 0});
+    size_t distinct = 0, uses = 0;
+    for (uint32_t id = 0; id < size(); id++) {
+        forEachTrigram(title(id), [&slots, &distinct, &uses](uint32_t trigram) {
+            size_t slot = findSlot(slots, trigram);
+            if (slots[slot].trigram == EMPTY_SLOT) {
+                slots[slot].trigram = trigram;
+                distinct++;
+                if (distinct * 2 > slots.size()) {
+                    growSlots(slots);
+                    slot = findSlot(slots, trigram);
+                }
+            }
+            slots[slot].count++;
+            uses++;
+        });
+    }
+
+    // then each count turns into where the trigram's next id goes
+    trigrams.clear();
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot].trigram != EMPTY_SLOT) {
+            trigrams.push_back(slots[slot].trigram);
+        }
+    }
+    sort(trigrams.begin(), trigrams.end());
+    postingStart.clear();
+    uint32_t next = 0;
+    for (size_t list = 0; list < trigrams.size(); list++) {
+        TrigramSlot &slot = slots[findSlot(slots, trigrams[list])];
+        postingStart.push_back(next);
+        next += slot.count;
+        slot.count = postingStart.back();
+    }
+    postingStart.push_back(next);
+
+    // going through the titles in order keeps the ids of each trigram ascending
+    postings.resize(uses);
+    for (uint32_t id = 0; id < size(); id++) {
+        forEachTrigram(title(id), [this, &slots, id](uint32_t trigram) {
+            postings[slots[findSlot(slots, trigram)].count++] = id;
+        });
+    }
+
+    // a title that repeats a trigram put its id in the trigram's list twice in a row
+    size_t kept = 0;
+    for (size_t list = 0; list < trigrams.size(); list++) {
+        uint32_t first = postingStart[list];
+        postingStart[list] = kept;
+        for (uint32_t i = first; i < postingStart[list + 1]; i++) {
+            if (i == first || postings[i] != postings[i - 1]) {
+                postings[kept++] = postings[i];
+            }
+        }
+    }
+    postingStart.back() = kept;
+    postings.resize(kept);
+    postings.shrink_to_fit();
+}
+
+
+///queries
+
+vector<uint32_t> TrigramIndex::containing(string_view text) const {
+    string query(text);
+    Appointment::foldCase(query.data(), query.length());
+    vector<uint32_t> matches;
+    if (query.length() < 3) {
+        for (uint32_t id = 0; id < size(); id++) {
+            if (title(id).find(query) != string_view::npos) {
+                matches.push_back(id);
+            }
+        }
+        return matches;
+    }
+
+    // having every trigram doesn't mean having them in the query's order
+    vector<uint32_t> candidates = sharingTrigrams(query, false);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (title(candidates[i]).find(query) != string_view::npos) {
+            matches.push_back(candidates[i]);
+        }
+    }
+
+    return matches;
+}
+
+vector<uint32_t> TrigramIndex::startingWith(string_view prefix) const {
+    string query(prefix);
+    Appointment::foldCase(query.data(), query.length());
+    vector<uint32_t> matches;
+    if (query.empty()) {
+        for (uint32_t id = 0; id < size(); id++) {
+            matches.push_back(id);
+        }
+        return matches;
+    }
+
+    vector<uint32_t> candidates = sharingTrigrams(query, true);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (title(candidates[i]).substr(0, query.length()) == query) {
+            matches.push_back(candidates[i]);
+        }
+    }
+
+    return matches;
+}
+
+size_t TrigramIndex::size() const {
+    return titleStart.size() - 1;
+}
+
+size_t TrigramIndex::trigramCount() const {
+    return trigrams.size();
+}
+
+
+///helpers
+
+bool TrigramIndex::titleMatches(string_view title, string_view foldedText, bool prefix) {
+    if (title.length() < foldedText.length()) {
+        return false;
+    }
+    if (prefix || foldedText.empty()) {
+        return Appointment::equalsIgnoringCase(title.substr(0, foldedText.length()), foldedText);
+    }
+
+    // each window is folded in place of the title, and only where its first char already matches
+    for (size_t i = 0; i + foldedText.length() <= title.length(); i++) {
+        char first = (title[i] >= 'a' && title[i] <= 'z') ? title[i] - 'a' + 'A' : title[i];
+        if (first == foldedText[0] && Appointment::equalsIgnoringCase(title.substr(i, foldedText.length()), foldedText)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+vector<uint32_t> TrigramIndex::sharingTrigrams(const string &query, bool prefix) const {
+    // the ids of every trigram of the query, as ranges of postings
+    vector<pair<uint32_t, uint32_t> > lists;
+    bool missing = false;
+    forEachTrigram(query, [this, &lists, &missing](uint32_t trigram) {
+        vector<uint32_t>::const_iterator found = lower_bound(trigrams.begin(), trigrams.end(), trigram);
+        if (found == trigrams.end() || *found != trigram) {
+            missing = true;  // no title has this trigram
+        }
+        else {
+            lists.push_back(make_pair(postingStart[found - trigrams.begin()], postingStart[found - trigrams.begin() + 1]));
+        }
+    }, !prefix);
+    if (missing || lists.empty()) {
+        return vector<uint32_t>();
+    }
+    sort(lists.begin(), lists.end(), [](const pair<uint32_t, uint32_t> &first, const pair<uint32_t, uint32_t> &second) {
+        return first.second - first.first < second.second - second.first;
+    });
+
+    // the candidates come from the shortest list and have to be in every other one
+    vector<uint32_t> candidates(postings.begin() + lists[0].first, postings.begin() + lists[0].second);
+    for (size_t list = 1; list < lists.size() && !candidates.empty(); list++) {
+        // both sides ascend, so each search gallops ahead from where the last one stopped; that costs
+        // little whether the candidates are few and far apart in the list or most of it
+        vector<uint32_t>::const_iterator next = postings.begin() + lists[list].first;
+        vector<uint32_t>::const_iterator last = postings.begin() + lists[list].second;
+        size_t kept = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            ptrdiff_t step = 1;
+            while (step < last - next && next[step] < candidates[i]) {
+                next += step;
+                step *= 2;
+            }
+            next = lower_bound(next, (step < last - next) ? next + step + 1 : last, candidates[i]);
+            if (next != last && *next == candidates[i]) {
+                candidates[kept++] = candidates[i];
+            }
+        }
+        candidates.resize(kept);
+    }
+
+    return candidates;
+}
+
+string_view TrigramIndex::title(uint32_t id) const {
+    return string_view(folded).substr(titleStart[id], titleStart[id + 1] - titleStart[id]);
+}
+
+template <typename Visit>
+void TrigramIndex::forEachTrigram(string_view text, Visit visit, bool inside) {
+    // the start of a title is marked with zero chars, which no title has, so prefixes get trigrams of their own
+    if (!inside && text.length() >= 1) {
+        visit(static_cast<unsigned char>(text[0]));
+    }
+    if (!inside && text.length() >= 2) {
+        visit(static_cast<unsigned char>(text[0]) << 8 | static_cast<unsigned char>(text[1]));
+    }
+    for (size_t i = 0; i + 3 <= text.length(); i++) {
+        visit(static_cast<unsigned char>(text[i]) << 16 | static_cast<unsigned char>(text[i + 1]) << 8 | static_cast<unsigned char>(text[i + 2]));
+    }
+}
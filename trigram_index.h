@@ -0,0 +1,119 @@
+/**
+ *   @file: trigram_index.h
+ * @author: Josh Marusek
+ *   @date: 2021-12-01
+ *  @brief: Static index of appointment titles for finding the ones that contain or start with some text, in any case.
+ * 
+ * Titles are folded to uppercase once, when the index is built. Each run of three chars in a folded title
+ * lists the titles it appears in, so a substring query only checks the titles that contain every run of
+ * three chars in the query. The first one and two chars of each title are listed as well, marked as the
+ * start, so a prefix query of any length only checks the titles that start the same way.
+ */
+
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "appointment.h"
+using namespace std;
+
+class TrigramIndex {
+    public:
+        /**
+         * @brief Construct a new empty TrigramIndex object.
+         */
+        TrigramIndex();
+
+        /**
+         * Function: build
+         * @brief Replaces the contents of the index with the titles of some appointments.
+         * 
+         * @param appointments the appointments, whose positions are the ids the queries return
+         */
+        void build(const vector<Appointment> &appointments);
+
+        /**
+         * Function: containing
+         * @brief Finds every title that contains some text, ignoring the case of ASCII letters.
+         * 
+         * Text shorter than three chars has no runs to look up, so every title is checked.
+         * 
+         * @param text the text
+         * @return ids of the matching titles in ascending order
+         */
+        vector<uint32_t> containing(string_view text) const;
+
+        /**
+         * Function: startingWith
+         * @brief Finds every title that starts with some text, ignoring the case of ASCII letters.
+         * 
+         * @param prefix the text
+         * @return ids of the matching titles in ascending order
+         */
+        vector<uint32_t> startingWith(string_view prefix) const;
+
+        /**
+         * Function: size
+         * @brief Gets the number of titles in the index.
+         * 
+         * @return number of titles
+         */
+        size_t size() const;
+
+        /**
+         * Function: trigramCount
+         * @brief Gets the number of distinct trigrams among the titles, counting the ones that mark where they start.
+         * 
+         * @return number of trigrams
+         */
+        size_t trigramCount() const;
+
+        /**
+         * Function: titleMatches
+         * @brief Checks one title the way the queries do, without an index or folding a copy of the title.
+         * 
+         * @param title the title
+         * @param foldedText the text, already folded to uppercase
+         * @param prefix whether the title has to start with the text instead of containing it
+         * @return true if the title matches
+         */
+        static bool titleMatches(string_view title, string_view foldedText, bool prefix);
+    private:
+        /**
+         * Function: title
+         * @brief Gets a folded title.
+         */
+        string_view title(uint32_t id) const;
+
+        /**
+         * Function: sharingTrigrams
+         * @brief Finds the titles that have every trigram of a folded query, which the caller still has to check.
+         * 
+         * @param query the query, folded to uppercase
+         * @param prefix whether to look up the trigrams that mark the start of a title as well
+         * @return ids of the candidates in ascending order
+         */
+        vector<uint32_t> sharingTrigrams(const string &query, bool prefix) const;
+
+        /**
+         * Function: forEachTrigram
+         * @brief Calls visit with every trigram of some text packed into 24 bits, repeats included.
+         * 
+         * @param text the folded text
+         * @param visit called with each trigram
+         * @param inside whether to skip the trigrams that mark the start of a title
+         */
+        template <typename Visit>
+        static void forEachTrigram(string_view text, Visit visit, bool inside = false);
+
+        string folded;                  // every title folded to uppercase, back to back
+        vector<uint32_t> titleStart;    // where each title starts in folded, followed by the end of the last one
+        vector<uint32_t> trigrams;      // every distinct trigram, sorted
+        vector<uint32_t> postingStart;  // where the ids of each trigram start in postings, followed by the end of the last one
+        vector<uint32_t> postings;      // ids of the titles containing each trigram, ascending within each trigram
+};
+
+#endif